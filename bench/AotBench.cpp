@@ -0,0 +1,84 @@
+// Runs the programs in bench/programs translated ahead of time to C++ and
+// on the interpreter, checks that both give the same result and compares
+// their run times.
+// Usage: AsmInterpAotBench
+
+#include "Compiler.h"
+#include "Machine.h"
+
+#include "collatz.h"
+#include "counted_loop.h"
+#include "no_end.h"
+#include "power.h"
+#include "recursion.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+struct Translated {
+    const char *name;
+    std::string (*function)();
+};
+
+template <typename Body> static auto best_seconds(Body body) -> double {
+    double best = 1e300;
+
+    for (int i = 0; i < 5; i++) {
+        const auto start = std::chrono::steady_clock::now();
+        body();
+        const auto stop = std::chrono::steady_clock::now();
+
+        best = std::min(
+            best, std::chrono::duration<double>(stop - start).count());
+    }
+
+    return best;
+}
+
+auto main() -> int {
+    const Translated programs[] = {
+        {"power", power},         {"counted_loop", counted_loop},
+        {"recursion", recursion}, {"collatz", collatz},
+        {"no_end", no_end},
+    };
+
+    std::printf("%-14s %12s %12s %9s\n", "program", "interp ms", "aot ms",
+                "speedup");
+
+    int mismatches = 0;
+    for (const auto &[name, function] : programs) {
+        std::ifstream file(std::string(ASMINTERP_BENCH_PROGRAMS "/") + name +
+                           ".asm");
+        std::stringstream source;
+        source << file.rdbuf();
+
+        const Program program = compile(source.str());
+        Machine machine(program);
+
+        std::string interpreted;
+        std::string translated;
+        const double interp_seconds = best_seconds([&] {
+            machine.reset();
+            machine.run();
+            interpreted = machine.result();
+        });
+        const double aot_seconds =
+            best_seconds([&] { translated = function(); });
+
+        if (interpreted != translated) {
+            std::fprintf(stderr, "%s: results differ\n  interpreter: %s\n"
+                                 "  translated:  %s\n",
+                         name, interpreted.c_str(), translated.c_str());
+            mismatches++;
+        }
+
+        std::printf("%-14s %12.3f %12.3f %9.1f\n", name, interp_seconds * 1e3,
+                    aot_seconds * 1e3, interp_seconds / aot_seconds);
+    }
+
+    return mismatches != 0;
+}
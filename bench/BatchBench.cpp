@@ -0,0 +1,70 @@
+// Throughput of run_batch on a CPU bound batch of seeded runs, per pool size.
+// Usage: AsmInterpBatchBench [jobs]
+
+#include "BatchExecutor.h"
+#include "Compiler.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+static constexpr const char *workload = R"PROGEND(
+mov i, 0
+mov s, 0
+loop:
+add s, i
+mul s, 3
+inc i
+cmp i, n
+jne loop
+msg 's = ', s
+end
+)PROGEND";
+
+auto main(int argc, char **argv) -> int {
+    const long job_count = argc > 1 ? std::atol(argv[1]) : 2000;
+    const size_t max_threads =
+        std::max(1U, std::thread::hardware_concurrency());
+
+    const auto program = std::make_shared<const Program>(compile(workload));
+
+    std::vector<BatchJob> jobs(job_count);
+    for (long i = 0; i < job_count; i++) {
+        jobs[i].program = program;
+        jobs[i].seeds = {{"n", 20000 + static_cast<int>(i % 100)}};
+    }
+
+    std::printf("%-8s %12s %10s %8s\n", "threads", "ms", "jobs/s", "speedup");
+
+    double single_thread = 0;
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        ThreadPool pool(threads);
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto results = run_batch(jobs, pool);
+        const auto stop = std::chrono::steady_clock::now();
+
+        for (const auto &result : results) {
+            if (!result.ok) {
+                std::fprintf(stderr, "job failed: %s\n", result.error.c_str());
+                return 1;
+            }
+        }
+
+        const double seconds =
+            std::chrono::duration<double>(stop - start).count();
+        if (threads == 1) {
+            single_thread = seconds;
+        }
+
+        std::printf("%-8zu %12.2f %10.0f %8.2f\n", threads, seconds * 1e3,
+                    job_count / seconds, single_thread / seconds);
+
+        if (threads < max_threads && threads * 2 > max_threads) {
+            threads = max_threads / 2; // Always measure all threads last
+        }
+    }
+}
@@ -0,0 +1,359 @@
+// Times every phase of running a program separately, on generated
+// workloads: line splitting, tokenizing, parsing, code generation (label
+// collection included), linking with and without optimization, and
+// execution under each dispatch engine.
+// Every figure is the median of repeated runs after a warm-up, along with
+// the fastest run and the median absolute deviation.
+// Usage: AsmInterpBench [--format=table|csv|json] [--repetitions=N]
+//                       [--scale=N] [--workload=NAME]
+
+#include "Compiler.h"
+#include "Machine.h"
+#include "Parser.h"
+#include "Scan.h"
+#include "Tokenizer.h"
+#include "Workloads.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+enum class Format { TABLE, CSV, JSON };
+
+struct Options {
+    Format format = Format::TABLE;
+    int repetitions = 9;
+    long scale = 1;
+    std::string workload; // Empty for all of them
+};
+
+struct Measurement {
+    std::string workload;
+    std::string phase;
+    double ops;   // What one run of the phase processes
+    double bytes; // Source bytes, for the front end phases
+    double median_ns;
+    double min_ns;
+    double mad_ns;
+};
+
+// Keeps the results of timed work observable
+static volatile size_t sink;
+
+template <typename Body>
+static auto measure(const int &repetitions, Body body)
+    -> std::vector<double> {
+    body(); // Warm-up, and the buffers reused by later runs grow here
+
+    std::vector<double> samples;
+    samples.reserve(repetitions);
+
+    for (int i = 0; i < repetitions; i++) {
+        const auto start = std::chrono::steady_clock::now();
+        body();
+        const auto stop = std::chrono::steady_clock::now();
+
+        samples.push_back(
+            std::chrono::duration<double, std::nano>(stop - start).count());
+    }
+
+    return samples;
+}
+
+static auto median(std::vector<double> values) -> double {
+    const size_t middle = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + middle, values.end());
+    if (values.size() % 2) {
+        return values[middle];
+    }
+    const double upper = values[middle];
+    return (upper +
+            *std::max_element(values.begin(), values.begin() + middle)) /
+           2;
+}
+
+static auto summarize(const std::string &workload, const std::string &phase,
+                      const double &ops, const double &bytes,
+                      const std::vector<double> &samples) -> Measurement {
+    const double mid = median(samples);
+
+    std::vector<double> deviations;
+    deviations.reserve(samples.size());
+    for (const auto &sample : samples) {
+        deviations.push_back(sample < mid ? mid - sample : sample - mid);
+    }
+
+    return {workload,
+            phase,
+            ops,
+            bytes,
+            mid,
+            *std::min_element(samples.begin(), samples.end()),
+            median(deviations)};
+}
+
+static auto run_workload(const Workload &workload, const Options &options,
+                         std::vector<Measurement> &results) -> void {
+    const std::string_view source = workload.source;
+    const double bytes = static_cast<double>(source.size());
+    const int reps = options.repetitions;
+
+    // Line splitting
+    std::vector<std::string_view> lines;
+    const auto split = [&] {
+        lines.clear();
+        const char *position = source.data();
+        const char *const end = source.data() + source.size();
+        while (position < end) {
+            const char *const line_end = scan_byte(position, end, '\n');
+            lines.emplace_back(position, line_end - position);
+            position = line_end + 1;
+        }
+    };
+    results.push_back(summarize(workload.name, "split", 0, bytes,
+                                measure(reps, split)));
+    results.back().ops = static_cast<double>(lines.size());
+
+    // Tokenizing, every line into its own reused buffer
+    std::vector<std::vector<Token>> line_tokens(lines.size());
+    size_t token_count = 0;
+    const auto tokenize = [&] {
+        token_count = 0;
+        for (size_t i = 0; i < lines.size(); i++) {
+            line_tokens[i].clear();
+            tokenizer(lines[i], static_cast<unsigned int>(i + 1),
+                      line_tokens[i]);
+            token_count += line_tokens[i].size();
+        }
+    };
+    results.push_back(summarize(workload.name, "tokenize", 0, bytes,
+                                measure(reps, tokenize)));
+    results.back().ops = static_cast<double>(token_count);
+
+    // Parsing, skipping the lines without tokens as the compiler does
+    std::vector<unsigned int> linenos;
+    for (size_t i = 0; i < lines.size(); i++) {
+        if (!line_tokens[i].empty()) {
+            linenos.push_back(static_cast<unsigned int>(i + 1));
+        }
+    }
+    std::vector<Instruction> instructions(
+        linenos.size(), Instruction(InstructionType::END));
+    const auto parse = [&] {
+        for (size_t i = 0; i < linenos.size(); i++) {
+            parser(line_tokens[linenos[i] - 1], linenos[i], instructions[i]);
+        }
+    };
+    results.push_back(
+        summarize(workload.name, "parse", static_cast<double>(linenos.size()),
+                  bytes, measure(reps, parse)));
+
+    // Code generation and linking. Each run needs a fresh generator, so
+    // generation is timed from its construction and linking on its own.
+    std::vector<double> codegen_samples;
+    std::vector<double> link_samples;
+    Program program;
+    for (int i = 0; i <= reps; i++) {
+        const auto start = std::chrono::steady_clock::now();
+        CodeGenerator generator;
+        for (size_t j = 0; j < linenos.size(); j++) {
+            generator.add(instructions[j], linenos[j]);
+        }
+        const auto generated = std::chrono::steady_clock::now();
+        program = generator.finish();
+        const auto linked = std::chrono::steady_clock::now();
+
+        if (i > 0) { // The first one is the warm-up
+            codegen_samples.push_back(
+                std::chrono::duration<double, std::nano>(generated - start)
+                    .count());
+            link_samples.push_back(
+                std::chrono::duration<double, std::nano>(linked - generated)
+                    .count());
+        }
+    }
+    results.push_back(summarize(workload.name, "codegen",
+                                static_cast<double>(linenos.size()), bytes,
+                                codegen_samples));
+    results.push_back(summarize(workload.name, "link",
+                                static_cast<double>(program.code.size()), 0,
+                                link_samples));
+
+    // Linking again, with every optimizer pass
+    std::vector<double> optimize_samples;
+    Program optimized;
+    for (int i = 0; i <= reps; i++) {
+        CodeGenerator generator;
+        for (size_t j = 0; j < linenos.size(); j++) {
+            generator.add(instructions[j], linenos[j]);
+        }
+        const auto start = std::chrono::steady_clock::now();
+        optimized = generator.finish(OptimizerPasses::all());
+        const auto stop = std::chrono::steady_clock::now();
+
+        if (i > 0) {
+            optimize_samples.push_back(
+                std::chrono::duration<double, std::nano>(stop - start)
+                    .count());
+        }
+    }
+    results.push_back(summarize(workload.name, "link+optimize",
+                                static_cast<double>(program.code.size()), 0,
+                                optimize_samples));
+
+    // Execution, last of the optimized program on the default engine
+    const std::tuple<const char *, const Program *, DispatchEngine>
+        engines[] = {
+            {"execute/switch", &program, DispatchEngine::SWITCH},
+            {"execute/threaded", &program, DispatchEngine::THREADED},
+            {"execute/jit", &program, DispatchEngine::JIT},
+            {"execute/optimized", &optimized, default_dispatch_engine},
+        };
+
+    // Every engine must agree with the first, as a differential check
+    std::string expected;
+    for (const auto &[phase, code, engine] : engines) {
+        Machine machine(*code);
+        const auto execute = [&, engine = engine] {
+            machine.reset();
+            if (!machine.run(engine)) {
+                std::fprintf(stderr, "%s: benchmark program did not end\n",
+                             workload.name.c_str());
+                std::exit(1);
+            }
+            sink = machine.output().size();
+        };
+        results.push_back(summarize(workload.name, phase,
+                                    workload.instructions, 0,
+                                    measure(reps, execute)));
+
+        if (code == &program && engine == DispatchEngine::SWITCH) {
+            expected = machine.output();
+        } else if (machine.output() != expected) {
+            std::fprintf(stderr, "%s: %s output differs from %s\n",
+                         workload.name.c_str(), phase,
+                         std::get<0>(engines[0]));
+            std::exit(1);
+        }
+    }
+}
+
+static auto print_table(const std::vector<Measurement> &results) -> void {
+    std::printf("%-14s %-17s %12s %12s %9s %8s %10s %10s\n", "workload",
+                "phase", "ops", "median ms", "min ms", "mad %", "ns/op",
+                "Mops/s");
+
+    for (const auto &m : results) {
+        std::printf("%-14s %-17s %12.0f %12.3f %9.3f %8.2f %10.2f %10.1f",
+                    m.workload.c_str(), m.phase.c_str(), m.ops,
+                    m.median_ns / 1e6, m.min_ns / 1e6,
+                    m.mad_ns / m.median_ns * 100, m.median_ns / m.ops,
+                    m.ops / m.median_ns * 1e3);
+        if (m.bytes > 0) {
+            std::printf(" %9.1f MB/s", m.bytes / m.median_ns * 1e3);
+        }
+        std::printf("\n");
+    }
+}
+
+static auto print_csv(const std::vector<Measurement> &results) -> void {
+    std::printf("workload,phase,ops,bytes,median_ns,min_ns,mad_ns,ns_per_op,"
+                "mops_per_s,mb_per_s\n");
+
+    for (const auto &m : results) {
+        std::printf("%s,%s,%.0f,%.0f,%.0f,%.0f,%.0f,%.3f,%.3f,%.3f\n",
+                    m.workload.c_str(), m.phase.c_str(), m.ops, m.bytes,
+                    m.median_ns, m.min_ns, m.mad_ns, m.median_ns / m.ops,
+                    m.ops / m.median_ns * 1e3, m.bytes / m.median_ns * 1e3);
+    }
+}
+
+static auto print_json(const std::vector<Measurement> &results,
+                       const Options &options) -> void {
+    std::printf("{\n  \"repetitions\": %d,\n  \"scale\": %ld,\n"
+                "  \"results\": [",
+                options.repetitions, options.scale);
+
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto &m = results[i];
+        std::printf("%s\n    {\"workload\": \"%s\", \"phase\": \"%s\", "
+                    "\"ops\": %.0f, \"bytes\": %.0f, \"median_ns\": %.0f, "
+                    "\"min_ns\": %.0f, \"mad_ns\": %.0f, "
+                    "\"ns_per_op\": %.3f, \"mops_per_s\": %.3f, "
+                    "\"mb_per_s\": %.3f}",
+                    i ? "," : "", m.workload.c_str(), m.phase.c_str(), m.ops,
+                    m.bytes, m.median_ns, m.min_ns, m.mad_ns,
+                    m.median_ns / m.ops, m.ops / m.median_ns * 1e3,
+                    m.bytes / m.median_ns * 1e3);
+    }
+
+    std::printf("\n  ]\n}\n");
+}
+
+static auto parse_options(int argc, char **argv) -> Options {
+    Options options;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string_view arg = argv[i];
+        const auto value = [&](const char *name) -> const char * {
+            const size_t length = std::strlen(name);
+            return arg.substr(0, length) == name ? argv[i] + length : nullptr;
+        };
+
+        if (const char *format = value("--format=")) {
+            if (std::strcmp(format, "table") == 0) {
+                options.format = Format::TABLE;
+            } else if (std::strcmp(format, "csv") == 0) {
+                options.format = Format::CSV;
+            } else if (std::strcmp(format, "json") == 0) {
+                options.format = Format::JSON;
+            } else {
+                std::fprintf(stderr, "unknown format: %s\n", format);
+                std::exit(2);
+            }
+        } else if (const char *repetitions = value("--repetitions=")) {
+            options.repetitions = std::max(1, std::atoi(repetitions));
+        } else if (const char *scale = value("--scale=")) {
+            options.scale = std::max(1l, std::atol(scale));
+        } else if (const char *workload = value("--workload=")) {
+            options.workload = workload;
+        } else {
+            std::fprintf(stderr,
+                         "usage: %s [--format=table|csv|json] "
+                         "[--repetitions=N] [--scale=N] [--workload=NAME]\n",
+                         argv[0]);
+            std::exit(2);
+        }
+    }
+
+    return options;
+}
+
+auto main(int argc, char **argv) -> int {
+    const Options options = parse_options(argc, argv);
+
+    std::vector<Measurement> results;
+    for (const auto &workload : standard_workloads(options.scale)) {
+        if (options.workload.empty() || options.workload == workload.name) {
+            run_workload(workload, options, results);
+        }
+    }
+
+    switch (options.format) {
+    case Format::TABLE:
+        print_table(results);
+        break;
+    case Format::CSV:
+        print_csv(results);
+        break;
+    case Format::JSON:
+        print_json(results, options);
+        break;
+    }
+}
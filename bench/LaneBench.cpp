@@ -0,0 +1,112 @@
+// Throughput of run_lanes against run_batch on one thread, for seedings
+// that keep their lanes together and for ones that branch apart.
+// Usage: AsmInterpLaneBench [seedings]
+
+#include "BatchExecutor.h"
+#include "Compiler.h"
+#include "LaneExecutor.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct LaneWorkload {
+    const char *name;
+    const char *source;
+    int first_seed;
+};
+
+// Trip counts differ a little from lane to lane
+constexpr const char *counted = R"PROGEND(
+mov i, 0
+mov s, 0
+loop:
+add s, i
+mul s, 3
+inc i
+cmp i, n
+jne loop
+msg 's = ', s
+end
+)PROGEND";
+
+// Every lane takes its own path through the branches
+constexpr const char *collatz = R"PROGEND(
+mov steps, 0
+mov x, n
+loop:
+cmp x, 1
+je done
+inc steps
+mov t, x
+div t, 2
+mul t, 2
+cmp t, x
+je even
+mul x, 3
+inc x
+jmp loop
+even:
+div x, 2
+jmp loop
+done:
+msg n, ': ', steps
+end
+)PROGEND";
+
+const LaneWorkload workloads[] = {
+    {"counted", counted, 20000},
+    {"collatz", collatz, 100000},
+};
+
+} // namespace
+
+auto main(int argc, char **argv) -> int {
+    const long count = argc > 1 ? std::atol(argv[1]) : 4000;
+    ThreadPool pool(1);
+
+    std::printf("%-10s %12s %12s %8s\n", "workload", "batch ms", "lanes ms",
+                "speedup");
+
+    for (const auto &workload : workloads) {
+        const auto program =
+            std::make_shared<const Program>(compile(workload.source));
+
+        std::vector<std::vector<std::pair<std::string, int>>> seeds(count);
+        std::vector<BatchJob> jobs(count);
+        for (long i = 0; i < count; i++) {
+            seeds[i] = {{"n", workload.first_seed + static_cast<int>(i % 100)}};
+            jobs[i].program = program;
+            jobs[i].seeds = seeds[i];
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        const auto batch = run_batch(jobs, pool);
+        const auto between = std::chrono::steady_clock::now();
+        const auto lanes = run_lanes(*program, seeds, pool);
+        const auto stop = std::chrono::steady_clock::now();
+
+        for (long i = 0; i < count; i++) {
+            if (!batch[i].ok || !lanes[i].ok ||
+                batch[i].output != lanes[i].output ||
+                batch[i].registers != lanes[i].registers) {
+                std::fprintf(stderr, "%s: seeding %ld differs\n",
+                             workload.name, i);
+                return 1;
+            }
+        }
+
+        const double batch_ms =
+            std::chrono::duration<double, std::milli>(between - start).count();
+        const double lanes_ms =
+            std::chrono::duration<double, std::milli>(stop - between).count();
+        std::printf("%-10s %12.2f %12.2f %8.2f\n", workload.name, batch_ms,
+                    lanes_ms, batch_ms / lanes_ms);
+    }
+}
@@ -0,0 +1,84 @@
+// Lexer throughput in MB/s for every scanning implementation the CPU
+// supports, on a large generated source.
+// Usage: AsmInterpLexerBench [megabytes]
+
+#include "Scan.h"
+#include "Tokenizer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+static auto generate_source(const size_t &size) -> std::string {
+    static const char *const lines[] = {
+        "mov   counter_register, 1000000        ; loop counter\n",
+        "    add   accumulator, counter_register\n",
+        "    msg   'the accumulator now holds ', accumulator, ' units'\n",
+        "    cmp   counter_register, -12345\n",
+        "; a full line comment describing the next block of the program\n",
+        "\tjne   loop_body_label_with_a_long_name\n",
+        "loop_body_label_with_a_long_name:\n",
+        "\n",
+        "    mul   a, b\n",
+    };
+
+    std::string source;
+    source.reserve(size + 128);
+
+    unsigned int seed = 12345;
+    while (source.size() < size) {
+        seed = seed * 1103515245 + 12345;
+        source += lines[(seed >> 16) % (sizeof(lines) / sizeof(lines[0]))];
+    }
+
+    return source;
+}
+
+static auto lex_seconds(const std::string &source, size_t &token_count)
+    -> double {
+    std::vector<Token> tokens;
+    token_count = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    Lexer lexer(source);
+    while (lexer.next_line(tokens)) {
+        token_count += tokens.size();
+    }
+    const auto stop = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double>(stop - start).count();
+}
+
+auto main(int argc, char **argv) -> int {
+    const long megabytes = argc > 1 ? std::atol(argv[1]) : 64;
+    constexpr int repetitions = 5;
+
+    const std::string source = generate_source(megabytes << 20);
+
+    const std::pair<const char *, ScanIsa> isas[] = {
+        {"scalar", ScanIsa::SCALAR},
+        {"sse2", ScanIsa::SSE2},
+        {"avx2", ScanIsa::AVX2},
+    };
+
+    std::printf("%-8s %10s %10s %12s\n", "isa", "ms", "MB/s", "tokens");
+
+    for (const auto &[name, isa] : isas) {
+        if (!set_scan_isa(isa)) {
+            std::printf("%-8s unsupported\n", name);
+            continue;
+        }
+
+        double best = 1e300;
+        size_t token_count = 0;
+        for (int i = 0; i < repetitions; i++) {
+            best = std::min(best, lex_seconds(source, token_count));
+        }
+
+        std::printf("%-8s %10.2f %10.1f %12zu\n", name, best * 1e3,
+                    source.size() / best / (1 << 20), token_count);
+    }
+}
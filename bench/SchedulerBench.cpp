@@ -0,0 +1,91 @@
+// Latency of well behaved programs sharing a Scheduler with runaway ones
+// that never end, against running them alone, per time slice.
+// Usage: AsmInterpSchedulerBench [vms] [runaways]
+
+#include "Compiler.h"
+#include "Scheduler.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+static constexpr const char *workload = R"PROGEND(
+mov i, 0
+mov s, 0
+loop:
+add s, i
+mul s, 3
+inc i
+cmp i, n
+jne loop
+msg 's = ', s
+end
+)PROGEND";
+
+static constexpr const char *runaway = R"PROGEND(
+mov i, 0
+loop:
+inc i
+jmp loop
+)PROGEND";
+
+// Milliseconds until every VM of a batch of count has ended, with
+// runaways spinning alongside them until they are cancelled
+static auto run(const std::shared_ptr<const Program> &program,
+                const std::shared_ptr<const Program> &spinner,
+                const long &count, const long &runaways,
+                const std::uint64_t &time_slice) -> double {
+    Scheduler scheduler(0, time_slice);
+
+    std::vector<Scheduler::VmId> spinning;
+    for (long i = 0; i < runaways; i++) {
+        spinning.push_back(scheduler.spawn(spinner));
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<Scheduler::VmId> ids;
+    for (long i = 0; i < count; i++) {
+        ids.push_back(scheduler.spawn(
+            program, {{"n", 20000 + static_cast<int>(i % 100)}}));
+    }
+    for (const auto &id : ids) {
+        if (const auto result = scheduler.wait(id);
+            result.status != VmStatus::ENDED) {
+            std::fprintf(stderr, "VM did not end: %s\n",
+                         result.error.c_str());
+            std::exit(1);
+        }
+    }
+
+    const auto stop = std::chrono::steady_clock::now();
+
+    for (const auto &id : spinning) {
+        scheduler.cancel(id);
+        scheduler.wait(id);
+    }
+
+    return std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+auto main(int argc, char **argv) -> int {
+    const long count = argc > 1 ? std::atol(argv[1]) : 2000;
+    const long runaways = argc > 2 ? std::atol(argv[2]) : 64;
+
+    const auto program = std::make_shared<const Program>(compile(workload));
+    const auto spinner = std::make_shared<const Program>(compile(runaway));
+
+    std::printf("%-10s %12s %14s %10s\n", "slice", "alone ms", "+runaways ms",
+                "slowdown");
+
+    for (const std::uint64_t slice : {1000, 10000, 100000}) {
+        const double alone = run(program, spinner, count, 0, slice);
+        const double shared = run(program, spinner, count, runaways, slice);
+
+        std::printf("%-10llu %12.2f %14.2f %10.2f\n",
+                    static_cast<unsigned long long>(slice), alone, shared,
+                    shared / alone);
+    }
+}
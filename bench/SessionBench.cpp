@@ -0,0 +1,64 @@
+// Latency of a one line edit through a CompileSession, against compiling
+// the whole edited source again, for growing sources.
+// Usage: AsmInterpSessionBench [edits]
+
+#include "CompileSession.h"
+#include "Compiler.h"
+#include "Workloads.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// Keeps the results of timed work observable
+static volatile size_t sink;
+
+template <typename Body>
+static auto micros(const long &count, Body body) -> double {
+    const auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < count; i++) {
+        body(i);
+    }
+    const auto stop = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::micro>(stop - start).count() /
+           static_cast<double>(count);
+}
+
+auto main(int argc, char **argv) -> int {
+    const long edits = argc > 1 ? std::max(1L, std::atol(argv[1])) : 50;
+
+    std::printf("%-10s %10s %14s %12s %14s\n", "lines", "edit us",
+                "edit+link us", "compile us", "speedup");
+
+    for (const size_t bytes : {16UL << 10, 256UL << 10, 4UL << 20}) {
+        const std::string source = large_source(bytes).source;
+        CompileSession session(source);
+        const size_t lines = session.line_count();
+
+        // Every edit retypes the immediate of a 'mov value, N' line, the
+        // third of each block
+        const auto edited = [&](const long &i) {
+            return "    mov   value, " + std::to_string(i);
+        };
+        const auto line = [&](const long &i) {
+            return 4 + 7 * (static_cast<size_t>(i * 7919) % (lines / 7 - 1));
+        };
+
+        const double edit = micros(edits, [&](const long &i) {
+            session.edit(line(i), 1, edited(i));
+        });
+        const double relink = micros(edits, [&](const long &i) {
+            session.edit(line(i), 1, edited(i));
+            sink = session.program().code.size();
+        });
+        const double full = micros(edits, [&](const long &) {
+            sink = compile(source).code.size();
+        });
+
+        std::printf("%-10zu %10.2f %14.2f %12.2f %13.1fx\n", lines, edit,
+                    relink, full, full / relink);
+    }
+}
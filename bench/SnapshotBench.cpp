@@ -0,0 +1,87 @@
+// Runs of a program with a long deterministic setup before it reads its
+// seed, each from the first instruction against each forked from a
+// snapshot taken once at the end of the setup.
+// Usage: AsmInterpSnapshotBench [runs]
+
+#include "Compiler.h"
+#include "Machine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+static constexpr const char *workload = R"PROGEND(
+mov i, 0
+mov table, 1
+setup:
+mul table, 31
+add table, i
+inc i
+cmp i, 200000
+jne setup
+msg 'setup done '
+seeded:
+mov r, table
+add r, seed
+mov j, 0
+work:
+mul r, 7
+inc j
+cmp j, 1000
+jne work
+msg r
+end
+)PROGEND";
+
+template <typename Body>
+static auto millis(Body body) -> double {
+    const auto start = std::chrono::steady_clock::now();
+    body();
+    const auto stop = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+auto main(int argc, char **argv) -> int {
+    const long runs = argc > 1 ? std::max(1L, std::atol(argv[1])) : 1000;
+
+    const Program program = compile(workload, OptimizerPasses::all());
+    std::string cold_output;
+    std::string warm_output;
+
+    const double cold = millis([&] {
+        Machine machine(program);
+        for (long i = 0; i < runs; i++) {
+            machine.reset();
+            machine.set_register("seed", static_cast<int>(i));
+            machine.run();
+            cold_output += machine.output();
+        }
+    });
+
+    const double warm = millis([&] {
+        Machine setup(program);
+        setup.run_to("seeded");
+        const auto snapshot = setup.snapshot();
+
+        Machine machine(program);
+        for (long i = 0; i < runs; i++) {
+            machine.restore(*snapshot);
+            machine.set_register("seed", static_cast<int>(i));
+            machine.resume();
+            warm_output += machine.output();
+        }
+    });
+
+    if (cold_output != warm_output) {
+        std::fprintf(stderr, "forked runs differ from cold runs\n");
+        return 1;
+    }
+
+    std::printf("%-8s %12s %12s %10s\n", "runs", "cold ms", "forked ms",
+                "speedup");
+    std::printf("%-8ld %12.2f %12.2f %9.1fx\n", runs, cold, warm,
+                cold / warm);
+}
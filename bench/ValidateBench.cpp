@@ -0,0 +1,92 @@
+// Finding every error of a source with a typo every few hundred lines:
+// compile() stops at the first error, so an edit-compile loop fixes them
+// one attempt at a time, against one validate() reporting them all. Also
+// times try_compile() against compile() on the fixed source.
+// Usage: AsmInterpValidateBench [errors]
+
+#include "Compiler.h"
+#include "Workloads.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <vector>
+
+// Keeps the results of timed work observable
+static volatile size_t sink;
+
+template <typename Body>
+static auto millis(Body body) -> double {
+    const auto start = std::chrono::steady_clock::now();
+    body();
+    const auto stop = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+auto main(int argc, char **argv) -> int {
+    const long errors = argc > 1 ? std::max(1L, std::atol(argv[1])) : 32;
+
+    const std::string source = large_source(1UL << 20).source;
+
+    // Offsets of the lines given a typo, spread over the source
+    std::vector<size_t> typos;
+    for (size_t at = source.find("mov"); at != std::string::npos &&
+                                         typos.size() < size_t(errors);
+         at = source.find("mov", at + source.size() / errors)) {
+        typos.push_back(at);
+    }
+    const auto with_typos = [&](const size_t &fixed) {
+        std::string broken = source;
+        for (size_t i = fixed; i < typos.size(); i++) {
+            broken[typos[i]] = 'w'; // 'wov' is no instruction
+        }
+        return broken;
+    };
+
+    // Each attempt sees the errors the previous ones reported fixed
+    std::vector<std::string> attempts;
+    for (size_t fixed = 0; fixed <= typos.size(); fixed++) {
+        attempts.push_back(with_typos(fixed));
+    }
+
+    size_t thrown = 0;
+    const double loop = millis([&] {
+        for (const auto &attempt : attempts) {
+            try {
+                sink = compile(attempt).code.size();
+            } catch (const std::exception &) {
+                thrown++;
+            }
+        }
+    });
+
+    size_t reported = 0;
+    const double once = millis([&] {
+        reported = validate(attempts.front()).size();
+    });
+
+    if (thrown != typos.size() || reported != typos.size()) {
+        std::fprintf(stderr, "expected %zu errors, compile found %zu, "
+                             "validate %zu\n",
+                     typos.size(), thrown, reported);
+        return 1;
+    }
+
+    const double full = millis([&] {
+        sink = compile(attempts.back()).code.size();
+    });
+    const double tried = millis([&] {
+        sink = try_compile(attempts.back()).program->code.size();
+    });
+
+    std::printf("%-8s %14s %12s %10s\n", "errors", "compile loop ms",
+                "validate ms", "speedup");
+    std::printf("%-8zu %14.2f %12.2f %9.1fx\n", typos.size(), loop, once,
+                loop / once);
+    std::printf("%-8s %14s %12s\n", "clean", "compile ms", "try ms");
+    std::printf("%-8s %14.2f %12.2f\n", "", full, tried);
+}
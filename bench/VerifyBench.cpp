@@ -0,0 +1,85 @@
+// Runs of every standard workload on the switch and threaded engines, with
+// the run time checks verify() proved unneeded left out, against the same
+// program making every check. Also reports how many checked instructions
+// are left and what verify() costs.
+// Usage: AsmInterpVerifyBench [scale] [repeats]
+
+#include "Compiler.h"
+#include "Machine.h"
+#include "Verifier.h"
+#include "Workloads.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+template <typename Body>
+static auto millis(Body body) -> double {
+    const auto start = std::chrono::steady_clock::now();
+    body();
+    const auto stop = std::chrono::steady_clock::now();
+
+    return std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+// Best of repeats runs, and the output of the last
+static auto best(const Program &program, const DispatchEngine &engine,
+                 const long &repeats, std::string &output) -> double {
+    Machine machine(program);
+    double fastest = 0;
+    for (long i = 0; i < repeats; i++) {
+        machine.reset();
+        const double run = millis([&] { machine.run(engine); });
+        fastest = i == 0 ? run : std::min(fastest, run);
+    }
+    output = machine.output();
+    return fastest;
+}
+
+auto main(int argc, char **argv) -> int {
+    const long scale = argc > 1 ? std::max(1L, std::atol(argv[1])) : 1;
+    const long repeats = argc > 2 ? std::max(1L, std::atol(argv[2])) : 5;
+
+    std::printf("%-14s %8s %10s %10s %11s %11s %8s\n", "workload", "checked",
+                "verify ms", "engine", "checked ms", "proven ms", "speedup");
+
+    for (const auto &workload : standard_workloads(scale)) {
+        const Program verified = compile(workload.source);
+
+        Program checked = verified;
+        const double verifying = millis([&] { verify(checked); });
+        checked.verified = false;
+        for (auto &op : checked.code) {
+            op.checks = ALL_CHECKS;
+        }
+
+        const auto left = std::count_if(
+            verified.code.begin(), verified.code.end(),
+            [](const Op &op) { return op.checks != 0; });
+
+        for (const auto engine :
+             {DispatchEngine::SWITCH, DispatchEngine::THREADED}) {
+            std::string checked_output;
+            std::string verified_output;
+            const double slow =
+                best(checked, engine, repeats, checked_output);
+            const double fast =
+                best(verified, engine, repeats, verified_output);
+
+            if (checked_output != verified_output) {
+                std::fprintf(stderr, "%s: output differs\n",
+                             workload.name.c_str());
+                return 1;
+            }
+
+            std::printf("%-14s %8ld %10.2f %10s %11.2f %11.2f %7.2fx\n",
+                        workload.name.c_str(), static_cast<long>(left),
+                        verifying,
+                        engine == DispatchEngine::SWITCH ? "switch"
+                                                         : "threaded",
+                        slow, fast, slow / fast);
+        }
+    }
+}
@@ -0,0 +1,126 @@
+#include "Workloads.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+auto straight_line(const long &lines) -> Workload {
+    static const char *const body[] = {
+        "mov a, 7\n", "add b, a\n",  "sub c, b\n", "mul a, 3\n",
+        "inc b\n",    "mov c, a\n", "dec a\n",    "add c, -12\n",
+    };
+    constexpr long body_size = sizeof(body) / sizeof(body[0]);
+
+    std::string source = "mov b, 0\nmov c, 0\n";
+    source.reserve(lines * 10 + 32);
+    for (long i = 0; i < lines; i++) {
+        source += body[i % body_size];
+    }
+    source += "end\n";
+
+    return {"straight_line", std::move(source), lines + 3.0};
+}
+
+auto counted_loop(const long &n) -> Workload {
+    return {"counted_loop",
+            "mov i, 0\n"
+            "mov s, 0\n"
+            "loop:\n"
+            "add s, i\n"
+            "inc i\n"
+            "cmp i, " + std::to_string(n) + "\n"
+            "jne loop\n"
+            "end\n",
+            3.0 + 4.0 * n};
+}
+
+auto nested_loops(const long &outer, const long &inner) -> Workload {
+    return {"nested_loops",
+            "mov i, 0\n"
+            "mov s, 0\n"
+            "outer:\n"
+            "mov j, 0\n"
+            "inner:\n"
+            "add s, j\n"
+            "inc j\n"
+            "cmp j, " + std::to_string(inner) + "\n"
+            "jl inner\n"
+            "inc i\n"
+            "cmp i, " + std::to_string(outer) + "\n"
+            "jl outer\n"
+            "end\n",
+            3.0 + outer * (4.0 + 4.0 * inner)};
+}
+
+auto recursion(const long &repeat, const long &depth) -> Workload {
+    return {"recursion",
+            "mov r, 0\n"
+            "again:\n"
+            "mov d, " + std::to_string(depth) + "\n"
+            "call proc_func\n"
+            "inc r\n"
+            "cmp r, " + std::to_string(repeat) + "\n"
+            "jne again\n"
+            "end\n"
+            "proc_func:\n"
+            "cmp d, 0\n"
+            "je continue\n"
+            "dec d\n"
+            "call proc_func\n"
+            "continue:\n"
+            "ret\n",
+            2.0 + repeat * (8.0 + 5.0 * depth)};
+}
+
+auto msg_heavy(const long &n) -> Workload {
+    return {"msg_heavy",
+            "mov i, 0\n"
+            "loop:\n"
+            "mov d, i\n"
+            "add d, i\n"
+            "msg 'i = ', i, ', twice = ', d\n"
+            "inc i\n"
+            "cmp i, " + std::to_string(n) + "\n"
+            "jne loop\n"
+            "end\n",
+            2.0 + 6.0 * n};
+}
+
+auto large_source(const size_t &bytes) -> Workload {
+    std::string source = "mov total, 0\n";
+    source.reserve(bytes + 256);
+
+    long blocks = 0;
+    while (source.size() < bytes) {
+        const auto block = std::to_string(blocks);
+        const auto next = std::to_string(blocks + 1);
+
+        source += "; block " + block + " adds its number to the total\n";
+        source += "block_" + block + ":\n";
+        source += "    mov   value, " + block + "\n";
+        source += "    add   total, value          ; running sum\n";
+        source += "\n";
+        source += "    cmp   value, total\n";
+        source += "    jne   block_" + next + "\n";
+        blocks++;
+    }
+    source += "block_" + std::to_string(blocks) + ":\n";
+    source += "    end\n";
+
+    // Every block runs its four instructions whether or not the jump is
+    // taken, as it always targets the next block
+    return {"large_source", std::move(source), 4.0 * blocks + 2.0};
+}
+
+auto standard_workloads(const long &scale) -> std::vector<Workload> {
+    std::vector<Workload> workloads;
+
+    workloads.push_back(straight_line(200000 * scale));
+    workloads.push_back(counted_loop(2000000 * scale));
+    workloads.push_back(nested_loops(2000 * scale, 1000));
+    workloads.push_back(recursion(500 * scale, 1000));
+    workloads.push_back(msg_heavy(200000 * scale));
+    workloads.push_back(large_source((16ul << 20) * scale));
+
+    return workloads;
+}
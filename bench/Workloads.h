@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// A generated program, along with what one run of it executes so the
+// benchmarks can report per instruction figures without profiling.
+struct Workload {
+    std::string name;
+    std::string source;
+    double instructions; // Instructions executed by one run
+};
+
+// 'lines' arithmetic instructions with no control flow
+auto straight_line(const long &lines) -> Workload;
+
+// Single loop of 'n' iterations around one addition
+auto counted_loop(const long &n) -> Workload;
+
+// Loop of 'inner' iterations inside one of 'outer' iterations
+auto nested_loops(const long &outer, const long &inner) -> Workload;
+
+// 'repeat' descents, 'depth' calls deep, through a proc_func subroutine
+auto recursion(const long &repeat, const long &depth) -> Workload;
+
+// Loop of 'n' iterations, each formatting a msg of four parts
+auto msg_heavy(const long &n) -> Workload;
+
+// About 'bytes' of source: labelled blocks with comments, blank lines and
+// jumps, executed front to back once
+auto large_source(const size_t &bytes) -> Workload;
+
+// Every workload above, sized so that each phase takes a few milliseconds
+// at scale 1
+auto standard_workloads(const long &scale) -> std::vector<Workload>;
@@ -0,0 +1,35 @@
+; Longest Collatz sequence for starting values below 100000
+mov n, 1
+mov best, 0
+mov best_n, 0
+next:
+    mov x, n
+    mov steps, 0
+step:
+    cmp x, 1
+    je done
+    mov half, x
+    div half, 2
+    mov even, half
+    mul even, 2
+    cmp even, x
+    je is_even
+    mul x, 3
+    inc x
+    inc steps
+    jmp step
+is_even:
+    mov x, half
+    inc steps
+    jmp step
+done:
+    cmp steps, best
+    jle not_better
+    mov best, steps
+    mov best_n, n
+not_better:
+    inc n
+    cmp n, 100000
+    jl next
+msg 'longest: ', best_n, ' (', best, ' steps)'
+end
@@ -0,0 +1,10 @@
+; Sum of 0 .. 49999999, wrapping around int
+mov i, 0
+mov s, 0
+loop:
+    add s, i
+    inc i
+    cmp i, 50000000
+    jne loop
+msg 'sum = ', s
+end
@@ -0,0 +1,10 @@
+; The first program of main.cpp
+mov  a, 5
+inc  a
+call function
+msg  '(5+1)/2 = ', a    ; output message
+end
+
+function:
+	div  a, 2
+	ret
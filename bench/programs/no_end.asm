@@ -0,0 +1,7 @@
+; Runs off its end without reaching 'end', so the result is -1
+mov a, 1
+loop:
+    msg 'step ', a, ' '
+    inc a
+    cmp a, 10
+    jl loop
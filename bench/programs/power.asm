@@ -0,0 +1,22 @@
+; a^b by repeated multiplication, through a recursive subroutine
+mov a, 2 ; value1
+mov b, 10 ; value2
+mov c, a ; temp1
+mov d, b ; temp2
+call proc_func
+call print
+end
+
+proc_func:
+cmp d, 1
+je continue
+mul c, a
+dec d
+call proc_func
+
+continue:
+ret
+
+print:
+msg a, '^', b, ' = ', c
+ret
@@ -0,0 +1,20 @@
+; 20000 descents through a subroutine 1000 calls deep
+mov r, 0
+mov calls, 0
+again:
+    mov d, 1000
+    call proc_func
+    inc r
+    cmp r, 20000
+    jne again
+msg 'calls = ', calls
+end
+
+proc_func:
+    inc calls
+    cmp d, 0
+    je continue
+    dec d
+    call proc_func
+continue:
+    ret
@@ -0,0 +1,30 @@
+# asminterp_add_program(<target> <function> <source>)
+#
+# Translates the assembly program <source> to C++ at build time, and
+# compiles it into <target> as
+#
+#     auto <function>() -> std::string;
+#
+# which returns what assembler_interpreter() would on <source>. The
+# declaration is in the generated header <function>.h, on <target>'s
+# include path. <source> is retranslated whenever it or the translator
+# changes.
+function(asminterp_add_program target function source)
+	get_filename_component(source_path "${source}" ABSOLUTE)
+	set(out_dir "${CMAKE_CURRENT_BINARY_DIR}/asminterp_programs")
+	set(out_cpp "${out_dir}/${function}.cpp")
+	set(out_h "${out_dir}/${function}.h")
+
+	add_custom_command(
+		OUTPUT "${out_cpp}" "${out_h}"
+		COMMAND "${CMAKE_COMMAND}" -E make_directory "${out_dir}"
+		COMMAND AsmInterpAot "${source_path}" "${function}" "${out_cpp}"
+			"${out_h}"
+		DEPENDS AsmInterpAot "${source_path}"
+		COMMENT "Translating ${source} to C++"
+		VERBATIM
+	)
+
+	target_sources(${target} PRIVATE "${out_cpp}" "${out_h}")
+	target_include_directories(${target} PRIVATE "${out_dir}")
+endfunction()
@@ -0,0 +1,422 @@
+#include "Aot.h"
+#include "Optimizer.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// C++ string literal of any bytes. Octal escapes always take three digits,
+// so they never swallow digits after them.
+static auto literal(const std::string_view &text) -> std::string {
+    static const char digits[] = "01234567";
+    std::string quoted = "\"";
+
+    for (const char c : text) {
+        const auto byte = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += c;
+        } else if (byte < 0x20 || byte >= 0x7f) {
+            quoted += '\\';
+            quoted += digits[byte >> 6];
+            quoted += digits[(byte >> 3) & 7];
+            quoted += digits[byte & 7];
+        } else {
+            quoted += c;
+        }
+    }
+
+    return quoted + '"';
+}
+
+static auto integer(const std::int32_t &value) -> std::string {
+    // -2147483648 would be the negation of a long
+    return value == INT_MIN ? "(-2147483647 - 1)" : std::to_string(value);
+}
+
+namespace {
+
+class CppEmitter {
+  public:
+    explicit CppEmitter(const Program &program)
+        : program(program), leaders(find_leaders(program)),
+          has_calls(std::any_of(program.code.begin(), program.code.end(),
+                                [](const Op &op) {
+                                    return op.code == OpCode::CALL;
+                                })) {}
+
+    auto emit(const std::string_view &function) -> std::string;
+
+  private:
+    auto line(const std::string &text) -> void {
+        out += "    ";
+        out += text;
+        out += '\n';
+    }
+
+    auto reg(const std::int32_t &slot) const -> std::string {
+        return "r" + std::to_string(slot);
+    }
+
+    // The operand as an expression, after check()
+    auto operand(const OperandKind &kind, const std::int32_t &value) const
+        -> std::string {
+        return kind == OperandKind::IMM ? integer(value) : reg(value);
+    }
+
+    // Whether the instruction being emitted needs the OpCheck
+    auto needs(const std::uint8_t &check) const -> bool {
+        return !program.verified || (current->checks & check) != 0;
+    }
+
+    auto check(const OperandKind &kind, const std::int32_t &value,
+               const std::uint32_t &lineno, const std::uint8_t &op_check)
+        -> void {
+        if (kind == OperandKind::REG && needs(op_check)) {
+            line("if (!d" + std::to_string(value) + ") {");
+            line("    unknown_register(" +
+                 literal(program.reg_names[value]) + ", " +
+                 std::to_string(lineno) + ");");
+            line("}");
+        }
+    }
+
+    auto fail(const char *message, const std::uint32_t &lineno) -> void {
+        line(std::string("fail(\"") + message + "\", " +
+             std::to_string(lineno) + ");");
+    }
+
+    auto instruction(const size_t &index, const Op &op) -> void;
+
+    const Program &program;
+    const std::vector<bool> leaders;
+    const bool has_calls; // Without any, every 'ret' fails
+    std::vector<size_t> return_addresses;
+    bool has_returns = false; // Some 'ret' jumps to the return switch
+    std::string out;
+    const Op *current = nullptr; // Being emitted
+};
+
+auto CppEmitter::instruction(const size_t &index, const Op &op) -> void {
+    current = &op;
+    const auto a = reg(op.a);
+    const auto b = operand(op.b_kind, op.b);
+    const auto target = "goto L" + std::to_string(op.target) + ";";
+
+    // The source operand is read before the destination, as in the
+    // interpreter, so the same error comes first
+    const auto arithmetic = [&](const char *wrap) {
+        check(op.b_kind, op.b, op.line, CHECK_B);
+        check(op.a_kind, op.a, op.line, CHECK_A);
+        line(a + " = " + wrap + "(" + a + ", " + b + ");");
+    };
+
+    const auto branch = [&](const char *condition) {
+        line(std::string("if (cmp_test ") + condition + " 0) {");
+        line("    " + target);
+        line("}");
+    };
+
+    switch (unfused(op.code)) {
+    case OpCode::MOV:
+        check(op.b_kind, op.b, op.line, CHECK_B);
+        line(a + " = " + b + ";");
+        line("d" + std::to_string(op.a) + " = true;");
+        break;
+    case OpCode::INC:
+        check(op.a_kind, op.a, op.line, CHECK_A);
+        line(a + " = wrap_add(" + a + ", 1);");
+        break;
+    case OpCode::DEC:
+        check(op.a_kind, op.a, op.line, CHECK_A);
+        line(a + " = wrap_sub(" + a + ", 1);");
+        break;
+    case OpCode::ADD:
+        arithmetic("wrap_add");
+        break;
+    case OpCode::SUB:
+        arithmetic("wrap_sub");
+        break;
+    case OpCode::MUL:
+        arithmetic("wrap_mul");
+        break;
+    case OpCode::DIV:
+        check(op.b_kind, op.b, op.line, CHECK_B);
+        if (op.b_kind == OperandKind::IMM && op.b == 0) {
+            fail("Division by Zero", op.line);
+            break;
+        }
+        if (op.b_kind == OperandKind::REG && needs(CHECK_DIVISOR)) {
+            line("if (" + b + " == 0) {");
+            out += "    ";
+            fail("Division by Zero", op.line);
+            line("}");
+        }
+        check(op.a_kind, op.a, op.line, CHECK_A);
+        line(a + " /= " + b + ";");
+        break;
+    case OpCode::CMP:
+        check(op.a_kind, op.a, op.line, CHECK_A);
+        check(op.b_kind, op.b, op.line, CHECK_B);
+        line("cmp_test = wrap_sub(" + operand(op.a_kind, op.a) + ", " + b +
+             ");");
+        break;
+    case OpCode::JMP:
+        line(target);
+        break;
+    case OpCode::JNE:
+        branch("!=");
+        break;
+    case OpCode::JE:
+        branch("==");
+        break;
+    case OpCode::JGE:
+        branch(">=");
+        break;
+    case OpCode::JG:
+        branch(">");
+        break;
+    case OpCode::JLE:
+        branch("<=");
+        break;
+    case OpCode::JL:
+        branch("<");
+        break;
+    case OpCode::CALL:
+        line("stack.push_back(" + std::to_string(index + 1) + ");");
+        line(target);
+        return_addresses.push_back(index + 1);
+        break;
+    case OpCode::RET:
+        if (!has_calls) {
+            fail("Nowhere to return!", op.line);
+            break;
+        }
+        if (needs(CHECK_STACK)) {
+            line("if (stack.empty()) {");
+            out += "    ";
+            fail("Nowhere to return!", op.line);
+            line("}");
+        }
+        line("return_to = stack.back();");
+        line("stack.pop_back();");
+        line("goto returns;");
+        has_returns = true;
+        break;
+    case OpCode::MSG: {
+        // Every register is checked before any output, as the interpreter
+        // only writes a fully formatted message
+        const auto first = program.msg_args.begin() + op.target;
+        const auto last = first + op.a;
+        for (auto arg = first; arg != last; arg++) {
+            check(arg->kind, arg->value, op.line, CHECK_A);
+        }
+        for (auto arg = first; arg != last; arg++) {
+            if (arg->kind == OperandKind::STR) {
+                line("output += " +
+                     literal(std::string_view(program.strings)
+                                 .substr(arg->value, arg->size)) +
+                     ";");
+            } else if (arg->kind == OperandKind::IMM) {
+                line("output += " + literal(std::to_string(arg->value)) +
+                     ";");
+            } else {
+                line("output += std::to_string(" + reg(arg->value) + ");");
+            }
+        }
+        break;
+    }
+    case OpCode::CLOSED_LOOP: {
+        // Runs the loop after it unless every register it reads is defined
+        const ClosedLoop &loop = program.loops[op.target];
+        const auto first = program.loop_updates.begin() + loop.first_update;
+        const auto last = first + loop.update_count;
+
+        std::string defined = "d" + std::to_string(loop.counter);
+        if (loop.bound_kind == OperandKind::REG) {
+            defined += " && d" + std::to_string(loop.bound);
+        }
+        for (auto update = first; update != last; update++) {
+            defined += " && d" + std::to_string(update->slot);
+            if (update->kind == OperandKind::REG) {
+                defined += " && d" + std::to_string(update->value);
+            }
+        }
+
+        const auto [low, high] = loop_exit_range(loop.condition);
+        line("if (" + defined + ") {");
+        line("    [[maybe_unused]] const unsigned c = "
+             "static_cast<unsigned>(" +
+             reg(loop.counter) + ");");
+        line("    const unsigned long long n = closed_loop(");
+        line("        static_cast<unsigned>(wrap_sub(wrap_add(" +
+             reg(loop.counter) + ", " + integer(loop.step) + "), " +
+             operand(loop.bound_kind, loop.bound) + ")),");
+        line("        " + std::to_string(low) + "u, " + std::to_string(high) +
+             "u, " + (loop.step > 0 ? "true" : "false") + ", cmp_test);");
+        line("    [[maybe_unused]] const unsigned long long t = "
+             "n * (n - 1) / 2;");
+        for (auto update = first; update != last; update++) {
+            // The counter moves by step each iteration, see
+            // run_closed_loop()
+            std::string total =
+                "n * static_cast<unsigned>(" +
+                operand(update->kind, update->value) + ")";
+            if (update->kind == OperandKind::REG &&
+                update->value == loop.counter) {
+                total = "n * (c + " + std::to_string(static_cast<unsigned>(
+                                          update->offset)) +
+                        "u) " + (loop.step > 0 ? "+" : "-") + " t";
+            }
+            const auto target = reg(update->slot);
+            line("    " + target + " = " +
+                 (update->code == OpCode::ADD ? "wrap_add" : "wrap_sub") +
+                 "(" + target + ", static_cast<int>(static_cast<unsigned>(" +
+                 total + ")));");
+        }
+        line("    goto L" + std::to_string(loop.exit) + ";");
+        line("}");
+        break;
+    }
+    case OpCode::END:
+        line("return output;");
+        break;
+    case OpCode::INVALID_INTEGER:
+        for (auto arg = program.msg_args.begin() + op.target,
+                  last = arg + op.a;
+             arg != last; arg++) {
+            if (arg->kind == OperandKind::REG) {
+                check(arg->kind, arg->value, op.line, CHECK_A);
+            }
+        }
+        fail("Unable to convert string to integer!", op.line);
+        break;
+    default: // HALT
+        line("return \"-1\";");
+        break;
+    }
+}
+
+auto CppEmitter::emit(const std::string_view &function) -> std::string {
+    out += "auto ";
+    out += function;
+    out += "() -> std::string {\n";
+
+    line("std::string output;");
+    line("[[maybe_unused]] std::vector<unsigned> stack; // Return addresses");
+    line("[[maybe_unused]] unsigned return_to = 0;");
+    line("[[maybe_unused]] int cmp_test = 0;");
+    for (size_t slot = 0; slot < program.reg_names.size(); slot++) {
+        const auto number = std::to_string(slot);
+        line("[[maybe_unused]] int r" + number + " = 0; // " +
+             program.reg_names[slot]);
+        line("[[maybe_unused]] bool d" + number + " = false;");
+    }
+
+    for (size_t i = 0; i < program.code.size(); i++) {
+        if (leaders[i]) {
+            out += "L" + std::to_string(i) + ":\n";
+        }
+        instruction(i, program.code[i]);
+    }
+
+    if (has_returns) {
+        out += "returns:\n";
+        line("switch (return_to) {");
+        for (size_t i = 0; i + 1 < return_addresses.size(); i++) {
+            const auto address = std::to_string(return_addresses[i]);
+            line("case " + address + ":");
+            line("    goto L" + address + ";");
+        }
+        line("default:");
+        line("    goto L" + std::to_string(return_addresses.back()) + ";");
+        line("}");
+    }
+
+    out += "}\n";
+    return std::move(out);
+}
+
+} // namespace
+
+static auto preamble(const std::string_view &source_name) -> std::string {
+    return "// Generated from " + std::string(source_name) +
+           " by AsmInterpAot, do not edit.\n\n";
+}
+
+auto translate_to_cpp(const Program &program, const std::string_view &function,
+                      const std::string_view &source_name) -> std::string {
+    return preamble(source_name) +
+           "#include <stdexcept>\n"
+           "#include <string>\n"
+           "#include <vector>\n"
+           "\n"
+           "namespace {\n"
+           "\n"
+           "[[noreturn, maybe_unused]] auto\n"
+           "fail(const char *message, const unsigned line) -> void {\n"
+           "    throw std::runtime_error(std::string(message) + \" Line: \" +\n"
+           "                             std::to_string(line));\n"
+           "}\n"
+           "\n"
+           "[[noreturn, maybe_unused]] auto\n"
+           "unknown_register(const char *name, const unsigned line) -> void {\n"
+           "    fail((std::string(\"Unknown register \") + name + \" "
+           "accessed.\")\n"
+           "             .c_str(),\n"
+           "         line);\n"
+           "}\n"
+           "\n"
+           "// Two's complement wraparound, as the interpreter's int "
+           "arithmetic\n"
+           "inline auto wrap_add(const int a, const int b) -> int {\n"
+           "    return static_cast<int>(static_cast<unsigned>(a) +\n"
+           "                            static_cast<unsigned>(b));\n"
+           "}\n"
+           "\n"
+           "inline auto wrap_sub(const int a, const int b) -> int {\n"
+           "    return static_cast<int>(static_cast<unsigned>(a) -\n"
+           "                            static_cast<unsigned>(b));\n"
+           "}\n"
+           "\n"
+           "inline auto wrap_mul(const int a, const int b) -> int {\n"
+           "    return static_cast<int>(static_cast<unsigned>(a) *\n"
+           "                            static_cast<unsigned>(b));\n"
+           "}\n"
+           "\n"
+           "// Iterations of a closed loop, cmp_test being entered after the "
+           "first one\n"
+           "// and ending it once in [low, high]\n"
+           "[[maybe_unused]] inline auto\n"
+           "closed_loop(const unsigned entered, const unsigned low, "
+           "const unsigned high,\n"
+           "            const bool up, int &cmp_test) -> unsigned long long {\n"
+           "    if (entered - low <= high - low) {\n"
+           "        cmp_test = static_cast<int>(entered);\n"
+           "        return 1;\n"
+           "    }\n"
+           "    cmp_test = static_cast<int>(up ? low : high);\n"
+           "    return 1ull + (up ? low - entered : entered - high);\n"
+           "}\n"
+           "\n"
+           "} // namespace\n"
+           "\n" +
+           CppEmitter(program).emit(function);
+}
+
+auto translate_to_cpp_header(const std::string_view &function,
+                             const std::string_view &source_name)
+    -> std::string {
+    return preamble(source_name) +
+           "#pragma once\n"
+           "\n"
+           "#include <string>\n"
+           "\n"
+           "// Runs the program, same as assembler_interpreter() on its "
+           "source\n"
+           "auto " +
+           std::string(function) + "() -> std::string;\n";
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Program.h"
+
+#include <string>
+#include <string_view>
+
+// Ahead of time translation of a compiled program into C++, to build fixed
+// programs into a binary (see asminterp_add_program() in
+// cmake/AsmInterpAot.cmake). The generated source defines
+//
+//     auto <function>() -> std::string;
+//
+// which behaves exactly like assembler_interpreter() on the program's
+// source: it returns the output, or "-1" if the program never reaches
+// 'end', and throws the same std::runtime_error on the same errors.
+// Registers become locals, jumps become gotos, and 'ret' picks its return
+// address in a switch. The generated code needs only the standard library.
+auto translate_to_cpp(const Program &program, const std::string_view &function,
+                      const std::string_view &source_name) -> std::string;
+
+// A header declaring the function translate_to_cpp() defines
+auto translate_to_cpp_header(const std::string_view &function,
+                             const std::string_view &source_name)
+    -> std::string;
@@ -1,7 +1,12 @@
 #pragma once
+#include "Compiler.h"
+#include "Machine.h"
+#include "Program.h"
+
 #include <string>
 #include <string_view>
-#include <unordered_map>
-#include <vector>
 
+// Compiles and runs a program once, returns its output or "-1" if it never
+// reached 'end'. To run a program many times, compile() it once and run it
+// on a Machine per run.
 auto assembler_interpreter(const std::string_view &program_source) -> std::string;
@@ -0,0 +1,105 @@
+#include "BatchExecutor.h"
+#include "Compiler.h"
+#include "Machine.h"
+
+#include <algorithm>
+#include <exception>
+#include <string_view>
+#include <unordered_map>
+
+namespace {
+
+struct CompiledSource {
+    std::shared_ptr<const Program> program;
+    std::string error;
+};
+
+} // namespace
+
+static auto run_job(const BatchJob &job, const Program &program)
+    -> BatchResult {
+    BatchResult result;
+
+    try {
+        Machine machine(program);
+        for (const auto &[name, value] : job.seeds) {
+            machine.set_register(name, value);
+        }
+
+        machine.run();
+
+        result.output = machine.result();
+        result.registers.reserve(program.reg_names.size());
+        for (const auto &name : program.reg_names) {
+            result.registers.push_back(machine.get_register(name));
+        }
+        result.ok = true;
+    } catch (const std::exception &e) {
+        result.error = e.what();
+    }
+
+    return result;
+}
+
+auto run_batch(const std::vector<BatchJob> &jobs, ThreadPool &pool)
+    -> std::vector<BatchResult> {
+    std::vector<BatchResult> results(jobs.size());
+
+    // Compile every distinct source once
+    std::unordered_map<std::string_view, size_t> source_index;
+    std::vector<size_t> job_source(jobs.size());
+    std::vector<std::string_view> sources;
+
+    for (size_t i = 0; i < jobs.size(); i++) {
+        if (jobs[i].program) {
+            continue;
+        }
+
+        auto [it, inserted] =
+            source_index.emplace(jobs[i].source, sources.size());
+        if (inserted) {
+            sources.push_back(jobs[i].source);
+        }
+        job_source[i] = it->second;
+    }
+
+    std::vector<CompiledSource> compiled(sources.size());
+    for (size_t i = 0; i < sources.size(); i++) {
+        pool.submit([&compiled, &sources, i] {
+            try {
+                compiled[i].program =
+                    std::make_shared<const Program>(compile(sources[i]));
+            } catch (const std::exception &e) {
+                compiled[i].error = e.what();
+            }
+        });
+    }
+    pool.wait();
+
+    // Jobs go to the pool in chunks, small enough for stealing to even
+    // out uneven run times.
+    const size_t chunk_size =
+        std::max<size_t>(1, jobs.size() / (pool.size() * 16));
+
+    for (size_t first = 0; first < jobs.size(); first += chunk_size) {
+        const size_t last = std::min(jobs.size(), first + chunk_size);
+
+        pool.submit([&, first, last] {
+            for (size_t i = first; i < last; i++) {
+                const auto &job = jobs[i];
+
+                if (job.program) {
+                    results[i] = run_job(job, *job.program);
+                } else if (const auto &source = compiled[job_source[i]];
+                           source.program) {
+                    results[i] = run_job(job, *source.program);
+                } else {
+                    results[i].error = source.error;
+                }
+            }
+        });
+    }
+    pool.wait();
+
+    return results;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Program.h"
+#include "ThreadPool.h"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+struct BatchJob {
+    // The program to run: either compiled already and shared with other
+    // jobs, or given as source, which is compiled once per distinct text.
+    std::shared_ptr<const Program> program;
+    std::string source;
+
+    // Registers set before the run
+    std::vector<std::pair<std::string, int>> seeds;
+};
+
+struct BatchResult {
+    bool ok = false;
+    std::string output; // Output or "-1", like assembler_interpreter
+    std::string error;  // What the job threw, if not ok
+    std::vector<std::optional<int>> registers; // By slot, after the run
+};
+
+// Runs every job on the pool. Results are in the order of the jobs, a job
+// that throws only fails its own result.
+auto run_batch(const std::vector<BatchJob> &jobs, ThreadPool &pool)
+    -> std::vector<BatchResult>;
@@ -0,0 +1,109 @@
+#include "CallMemo.h"
+
+#include <algorithm>
+
+CallMemo::CallMemo(const Program &program, const size_t &capacity) noexcept
+    : program(program), capacity(capacity), stride(HEAD) {
+    for (const auto &routine : program.pure_routines) {
+        stride = std::max<size_t>(stride, HEAD + 2 * routine.slot_count);
+    }
+}
+
+auto CallMemo::set_capacity(const size_t &entries) -> void {
+    capacity = entries;
+    table.clear();
+    table.shrink_to_fit();
+    abandon();
+}
+
+auto CallMemo::call(const std::int32_t &routine, int *values,
+                    std::uint8_t *defined, int &cmp_test, const size_t &depth)
+    -> bool {
+    if (capacity == 0) {
+        return false;
+    }
+    if (table.empty()) {
+        table.assign(capacity * stride, 0);
+    }
+
+    const PureRoutine &pure = program.pure_routines[routine];
+    const std::int32_t *const slots =
+        program.pure_slots.data() + pure.first_slot;
+
+    // Undefined registers key as 0, only their being undefined matters
+    std::uint32_t defined_in = 0;
+    const int cmp_in = pure.reads_cmp_test ? cmp_test : 0;
+    std::uint64_t hash = 14695981039346656037ULL ^
+                         static_cast<std::uint32_t>(routine) ^
+                         (static_cast<std::uint64_t>(
+                              static_cast<std::uint32_t>(cmp_in))
+                          << 32);
+    for (std::uint32_t i = 0; i < pure.slot_count; i++) {
+        const auto slot = slots[i];
+        const auto value = defined[slot] ? values[slot] : 0;
+        defined_in |= (defined[slot] ? 1U : 0U) << i;
+        hash = (hash ^ static_cast<std::uint32_t>(value)) * 1099511628211ULL;
+    }
+    hash = (hash ^ defined_in) * 1099511628211ULL;
+
+    const size_t entry = (hash ^ (hash >> 29)) % capacity * stride;
+    std::int32_t *const cached = table.data() + entry;
+
+    bool hit = cached[ROUTINE] == routine + 1 &&
+               static_cast<std::uint32_t>(cached[DEFINED_IN]) == defined_in &&
+               cached[CMP_IN] == cmp_in;
+    for (std::uint32_t i = 0; hit && i < pure.slot_count; i++) {
+        hit = cached[HEAD + i] == (defined[slots[i]] ? values[slots[i]] : 0);
+    }
+
+    if (hit) {
+        hit_count++;
+        const std::int32_t *const out = cached + HEAD + pure.slot_count;
+        const auto defined_out =
+            static_cast<std::uint32_t>(cached[DEFINED_OUT]);
+        for (std::uint32_t i = 0; i < pure.slot_count; i++) {
+            if (pure.written & (1U << i)) {
+                values[slots[i]] = out[i];
+                defined[slots[i]] = (defined_out >> i) & 1;
+            }
+        }
+        if (pure.writes_cmp_test) {
+            cmp_test = cached[CMP_OUT];
+        }
+        return true;
+    }
+
+    miss_count++;
+    pending.push_back({depth, entry, routine, defined_in, cmp_in});
+    for (std::uint32_t i = 0; i < pure.slot_count; i++) {
+        pending_keys.push_back(defined[slots[i]] ? values[slots[i]] : 0);
+    }
+    return false;
+}
+
+auto CallMemo::record(const int *values, const std::uint8_t *defined,
+                      const int &cmp_test) -> void {
+    const Pending call = pending.back();
+    pending.pop_back();
+
+    const PureRoutine &pure = program.pure_routines[call.routine];
+    const std::int32_t *const slots =
+        program.pure_slots.data() + pure.first_slot;
+    const auto keys = pending_keys.end() - pure.slot_count;
+
+    std::int32_t *const cached = table.data() + call.entry;
+    std::uint32_t defined_out = 0;
+    for (std::uint32_t i = 0; i < pure.slot_count; i++) {
+        cached[HEAD + i] = keys[i];
+        cached[HEAD + pure.slot_count + i] =
+            defined[slots[i]] ? values[slots[i]] : 0;
+        defined_out |= (defined[slots[i]] ? 1U : 0U) << i;
+    }
+    cached[ROUTINE] = call.routine + 1;
+    cached[DEFINED_IN] = static_cast<std::int32_t>(call.defined_in);
+    cached[DEFINED_OUT] = static_cast<std::int32_t>(defined_out);
+    cached[CMP_IN] = call.cmp_in;
+    cached[CMP_OUT] = cmp_test;
+
+    pending_keys.erase(keys, pending_keys.end());
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Program.h"
+
+#include <cstdint>
+#include <vector>
+
+// Recorded results of calls to pure subroutines, see PureRoutine, for one
+// Machine. The table is bounded and direct mapped: a call recorded into an
+// entry replaces whatever it held. Results only depend on the program, so
+// they stay valid from one run to the next.
+class CallMemo {
+  public:
+    explicit CallMemo(const Program &program,
+                      const size_t &capacity = 1024) noexcept;
+
+    // Applies the recorded result of a call to routine on the registers
+    // and cmp_test, if there is one. Otherwise returns false and records
+    // the call, until it returns from depth, the call stack size inside it.
+    auto call(const std::int32_t &routine, int *values,
+              std::uint8_t *defined, int &cmp_test, const size_t &depth)
+        -> bool;
+
+    // A return left the call stack at depth, which ends the call being
+    // recorded if it was made from there
+    auto returned(const size_t &depth, const int *values,
+                  const std::uint8_t *defined, const int &cmp_test) -> void {
+        if (!pending.empty() && pending.back().depth == depth + 1) {
+            record(values, defined, cmp_test);
+        }
+    }
+
+    // Drops the calls being recorded, a run that failed or started over
+    // never returns from them
+    auto abandon() noexcept -> void {
+        pending.clear();
+        pending_keys.clear();
+    }
+
+    // Entries of the table, 0 to stop memoizing. Forgets every result.
+    auto set_capacity(const size_t &entries) -> void;
+
+    auto hits() const noexcept -> std::uint64_t { return hit_count; }
+    auto misses() const noexcept -> std::uint64_t { return miss_count; }
+
+  private:
+    // Entry layout, in ints: routine + 1 (0 for empty), defined masks on
+    // call and return, cmp_test on call and return, the routine's
+    // registers on call, then on return
+    enum : size_t { ROUTINE, DEFINED_IN, DEFINED_OUT, CMP_IN, CMP_OUT, HEAD };
+
+    struct Pending {
+        size_t depth;
+        size_t entry; // Where the result goes
+        std::int32_t routine;
+        std::uint32_t defined_in;
+        int cmp_in;
+    };
+
+    auto record(const int *values, const std::uint8_t *defined,
+                const int &cmp_test) -> void;
+
+    const Program &program;
+    size_t capacity;
+    size_t stride; // Ints per entry
+    std::vector<std::int32_t> table; // Allocated on the first call
+    std::vector<Pending> pending;
+    std::vector<std::int32_t> pending_keys; // Registers of every pending
+    std::uint64_t hit_count = 0;
+    std::uint64_t miss_count = 0;
+};
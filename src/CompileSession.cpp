@@ -0,0 +1,196 @@
+#include "CompileSession.h"
+#include "Compiler.h"
+#include "Errors.h"
+#include "Lowering.h"
+#include "Scan.h"
+#include "Verifier.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+CompileSession::CompileSession(const std::string_view &source) {
+    edit(1, 0, source);
+}
+
+auto CompileSession::edit(const size_t &first, const size_t &count,
+                          const std::string_view &text) -> void {
+    if (first == 0 || first - 1 > lines.size() ||
+        count > lines.size() - (first - 1)) {
+        throw std::out_of_range("Edit past the last line");
+    }
+
+    // Split as Lexer::next_line() does, lowering every line on its own.
+    // Line numbers aren't known for good until program(), which rethrows
+    // errors with the right one.
+    std::vector<std::unique_ptr<Line>> inserted;
+    size_t position = 0;
+    while (position < text.size()) {
+        const char *const line_start = text.data() + position;
+        const size_t line_end =
+            scan_byte(line_start, text.data() + text.size(), '\n') -
+            text.data();
+
+        auto line = std::make_unique<Line>();
+        line->text = text.substr(position, line_end - position);
+        try {
+            lower_line(*line, 0);
+        } catch (const std::exception &) {
+            auto failed = std::make_unique<Line>();
+            failed->text = std::move(line->text);
+            failed->failed = true;
+            line = std::move(failed);
+        }
+        inserted.push_back(std::move(line));
+
+        position = line_end + 1;
+    }
+
+    const auto removed_begin = lines.begin() + (first - 1);
+    const auto removed_end = removed_begin + count;
+    for (auto it = removed_begin; it != removed_end; it++) {
+        release_label((*it)->label);
+    }
+
+    // Lines replaced in place, the rest shift over
+    const size_t common = std::min(count, inserted.size());
+    std::move(inserted.begin(), inserted.begin() + common, removed_begin);
+    if (count > common) {
+        lines.erase(removed_begin + common, removed_end);
+    } else {
+        lines.insert(removed_begin + common,
+                     std::make_move_iterator(inserted.begin() + common),
+                     std::make_move_iterator(inserted.end()));
+    }
+}
+
+auto CompileSession::source() const -> std::string {
+    std::string text;
+    for (const auto &line : lines) {
+        text += line->text;
+        text += '\n';
+    }
+    return text;
+}
+
+auto CompileSession::program(const OptimizerPasses &passes) -> Program {
+    Program compiled;
+    compiled.code.reserve(lines.size() + 1);
+    compiled.reg_names.assign(reg_names.begin(), reg_names.end());
+
+    // A label is defined in this link once its link matches
+    links++;
+    jumps.clear();
+
+    for (size_t i = 0; i < lines.size(); i++) {
+        const Line &line = *lines[i];
+        const auto lineno = static_cast<unsigned int>(i + 1);
+        const auto code_size =
+            static_cast<std::uint32_t>(compiled.code.size());
+
+        if (line.failed) { // Throws again, now with its line number
+            Line retry;
+            retry.text = line.text;
+            lower_line(retry, lineno);
+        }
+
+        if (!line.emits) {
+            if (line.label != nullptr) {
+                auto &[name, label] = *line.label;
+                if (label.link == links) {
+                    PARSE_ERR(lineno, "Label redeclaration error");
+                }
+                label.link = links;
+                label.target = code_size;
+                compiled.labels.push_back({name, code_size});
+            }
+            continue;
+        }
+
+        Op op = line.op;
+        op.line = lineno;
+
+        if (line.label != nullptr) {
+            jumps.emplace_back(compiled.code.size(), line.label);
+        } else if (op.code == OpCode::MSG ||
+                   op.code == OpCode::INVALID_INTEGER) {
+            op.target = static_cast<std::uint32_t>(compiled.msg_args.size());
+            const auto strings_size =
+                static_cast<std::int32_t>(compiled.strings.size());
+            for (MsgArg arg : line.msg_args) {
+                if (arg.kind == OperandKind::STR) {
+                    arg.value += strings_size;
+                }
+                compiled.msg_args.push_back(arg);
+            }
+            compiled.strings += line.strings;
+        }
+
+        compiled.code.push_back(op);
+    }
+
+    // Linking
+    for (const auto &[index, entry] : jumps) {
+        const auto &[name, label] = *entry;
+        if (label.link != links) {
+            PARSE_ERR(compiled.code[index].line,
+                      "Undefined label " + name + " referenced.");
+        }
+        compiled.code[index].target = label.target;
+    }
+
+    compiled.code.push_back({OpCode::HALT});
+
+    optimize(compiled, passes);
+    fuse_superinstructions(compiled);
+    verify(compiled);
+
+    return compiled;
+}
+
+// Lowers a line on its own. Labels are only counted here and get their
+// targets in program(), as do the 'msg' arguments their places.
+auto CompileSession::lower_line(Line &line, const unsigned int &lineno)
+    -> void {
+    tokens.clear();
+    tokenizer(line.text, lineno, tokens);
+    if (tokens.empty()) {
+        return;
+    }
+    parser(tokens, lineno, instruction);
+
+    const auto lowered = lower_instruction(
+        instruction, lineno,
+        [this](const std::string_view &reg) { return reg_slot(reg); },
+        line.op, line.msg_args, line.strings);
+
+    // Last, so a line that throws never holds a label
+    if (lowered != Lowered::OP) {
+        line.label = acquire_label(instruction.paramemters[0].token_data);
+    }
+    line.emits = lowered != Lowered::LABEL;
+}
+
+auto CompileSession::reg_slot(const std::string_view &reg) -> std::int32_t {
+    if (auto search = reg_slots.find(reg); search != reg_slots.end()) {
+        return search->second;
+    }
+
+    const auto slot = static_cast<std::int32_t>(reg_names.size());
+    reg_slots.emplace(reg_names.emplace_back(reg), slot);
+    return slot;
+}
+
+auto CompileSession::acquire_label(const std::string_view &name)
+    -> LabelEntry * {
+    auto &entry = *labels.try_emplace(std::string(name)).first;
+    entry.second.uses++;
+    return &entry;
+}
+
+// Forgets labels no line mentions anymore
+auto CompileSession::release_label(LabelEntry *const &label) -> void {
+    if (label != nullptr && --label->second.uses == 0) {
+        labels.erase(labels.find(label->first));
+    }
+}
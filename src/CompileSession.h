@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Optimizer.h"
+#include "Parser.h"
+#include "Program.h"
+#include "Tokenizer.h"
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Compiles a source that keeps being edited, as behind an editor or a
+// REPL. Every line keeps its lowered instruction, so an edit only lexes,
+// parses and lowers the lines it brings in, and program() links what the
+// lines hold in one pass without looking at the source text again.
+class CompileSession {
+  public:
+    explicit CompileSession(const std::string_view &source = {});
+
+    // Replaces count lines from line first, numbered from 1 as in
+    // diagnostics, with the lines of text. Text splits into lines as
+    // compile() splits a source: "" is no line at all, and a final newline
+    // doesn't start another one. Errors in the text are only thrown by
+    // program(); edit() throws std::out_of_range for lines past the end.
+    auto edit(const size_t &first, const size_t &count,
+              const std::string_view &text) -> void;
+
+    auto line_count() const noexcept -> size_t { return lines.size(); }
+
+    // The source as edited so far, every line ended by a newline
+    auto source() const -> std::string;
+
+    // What compile(source(), passes) returns, or throws, except that
+    // register slots are numbered over the whole session: they can differ
+    // from compile()'s, and registers edited away keep theirs.
+    auto program(const OptimizerPasses &passes = {}) -> Program;
+
+  private:
+    struct LabelUses {
+        size_t uses = 0;        // Lines defining it or jumping to it
+        std::uint64_t link = 0; // Last program() that saw its definition
+        std::uint32_t target = 0;
+    };
+    using LabelEntry = std::unordered_map<std::string, LabelUses>::value_type;
+
+    struct Line {
+        std::string text; // The tokens of the line point into it
+        bool failed = false; // Threw when lowered, program() rethrows
+        bool emits = false;  // op is an instruction of the program
+        Op op{OpCode::END};
+        LabelEntry *label = nullptr; // Defined by the line, or jumped to
+        std::vector<MsgArg> msg_args; // STR values are offsets in strings
+        std::string strings;
+    };
+
+    auto lower_line(Line &line, const unsigned int &lineno) -> void;
+    auto reg_slot(const std::string_view &reg) -> std::int32_t;
+    auto acquire_label(const std::string_view &name) -> LabelEntry *;
+    auto release_label(LabelEntry *const &label) -> void;
+
+    // Behind unique_ptr, so the line texts never move
+    std::vector<std::unique_ptr<Line>> lines;
+
+    std::unordered_map<std::string, LabelUses> labels;
+    std::uint64_t links = 0;
+
+    // Register slots of the session; the deque keeps the names in place
+    // for the views keying the map
+    std::deque<std::string> reg_names;
+    std::unordered_map<std::string_view, std::int32_t> reg_slots;
+
+    // Buffers reused by every line lowered and every program() call
+    std::vector<Token> tokens;
+    Instruction instruction{InstructionType::END};
+    std::vector<std::pair<size_t, LabelEntry *>> jumps;
+};
@@ -0,0 +1,288 @@
+#include "Compiler.h"
+#include "Errors.h"
+#include "Lowering.h"
+#include "Optimizer.h"
+#include "Parser.h"
+#include "Scan.h"
+#include "Tokenizer.h"
+#include "Verifier.h"
+
+#include <algorithm>
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+auto to_opcode(const InstructionType &ins_type) -> OpCode {
+    switch (ins_type) {
+    case InstructionType::MOV:
+        return OpCode::MOV;
+    case InstructionType::INC:
+        return OpCode::INC;
+    case InstructionType::DEC:
+        return OpCode::DEC;
+    case InstructionType::ADD:
+        return OpCode::ADD;
+    case InstructionType::SUB:
+        return OpCode::SUB;
+    case InstructionType::MUL:
+        return OpCode::MUL;
+    case InstructionType::DIV:
+        return OpCode::DIV;
+    case InstructionType::JMP:
+        return OpCode::JMP;
+    case InstructionType::CMP:
+        return OpCode::CMP;
+    case InstructionType::JNE:
+        return OpCode::JNE;
+    case InstructionType::JE:
+        return OpCode::JE;
+    case InstructionType::JGE:
+        return OpCode::JGE;
+    case InstructionType::JG:
+        return OpCode::JG;
+    case InstructionType::JLE:
+        return OpCode::JLE;
+    case InstructionType::JL:
+        return OpCode::JL;
+    case InstructionType::CALL:
+        return OpCode::CALL;
+    case InstructionType::RET:
+        return OpCode::RET;
+    case InstructionType::MSG:
+        return OpCode::MSG;
+    case InstructionType::END:
+    case InstructionType::LABEL: // Labels are never emitted
+        break;
+    }
+
+    return OpCode::END;
+}
+
+auto CodeGenerator::reg_slot(const std::string_view &reg) -> std::int32_t {
+    if (auto search = reg_slots.find(reg); search != reg_slots.end()) {
+        return search->second;
+    }
+
+    const auto slot = static_cast<std::int32_t>(compiled.reg_names.size());
+    reg_slots.emplace(reg, slot);
+    compiled.reg_names.emplace_back(reg);
+    return slot;
+}
+
+auto CodeGenerator::add(const Instruction &instruction,
+                        const unsigned int &lineno) -> void {
+    const auto &paramemters = instruction.paramemters;
+    Op op{OpCode::END};
+
+    switch (lower_instruction(
+        instruction, lineno,
+        [this](const std::string_view &reg) { return reg_slot(reg); }, op,
+        compiled.msg_args, compiled.strings)) {
+    case Lowered::LABEL: {
+        const auto code_size = static_cast<std::uint32_t>(compiled.code.size());
+
+        if (label_defs.find(paramemters[0].token_data) == label_defs.end()) {
+            label_defs[paramemters[0].token_data] = code_size;
+            compiled.labels.push_back(
+                {std::string(paramemters[0].token_data), code_size});
+        } else {
+            PARSE_ERR(lineno, "Label redeclaration error");
+        }
+        return;
+    }
+
+    case Lowered::JUMP:
+        label_refs.emplace_back(compiled.code.size(),
+                                paramemters[0].token_data);
+        break;
+
+    case Lowered::OP:
+        break;
+    }
+
+    compiled.code.push_back(op);
+}
+
+auto CodeGenerator::finish(const OptimizerPasses &passes) -> Program {
+    // Linking
+    for (const auto &[index, label] : label_refs) {
+        if (auto search = label_defs.find(label); search != label_defs.end()) {
+            compiled.code[index].target = search->second;
+        } else {
+            PARSE_ERR(compiled.code[index].line,
+                      "Undefined label " + std::string(label) + " referenced.");
+        }
+    }
+
+    // Every jump target and return address is now inside the code, so the
+    // interpreter never has to bounds check the program counter.
+    compiled.code.push_back({OpCode::HALT});
+
+    optimize(compiled, passes);
+    fuse_superinstructions(compiled);
+    verify(compiled);
+
+    return std::move(compiled);
+}
+
+auto compile(const std::string_view &program_source) -> Program {
+    return compile(program_source, OptimizerPasses{});
+}
+
+auto compile(const std::string_view &program_source,
+             const OptimizerPasses &passes) -> Program {
+    CodeGenerator generator;
+
+    // Lexing, parsing and code generation happen in one pass over the
+    // source, reusing the same token and parameter buffers for every line.
+    Lexer lexer(program_source);
+    std::vector<Token> tokens;
+    Instruction instruction(InstructionType::END);
+
+    while (lexer.next_line(tokens)) {
+        parser(tokens, lexer.lineno(), instruction);
+        generator.add(instruction, lexer.lineno());
+    }
+
+    return generator.finish(passes);
+}
+
+// Checks every line of a source, collecting its errors and warnings into
+// diagnostics. Lines are handed to generator, if any, as long as none had
+// an error. Returns whether none had.
+static auto check(const std::string_view &program_source,
+                  CodeGenerator *generator,
+                  std::vector<Diagnostic> &diagnostics) -> bool {
+    std::vector<Token> tokens;
+    Instruction instruction(InstructionType::END);
+    Diagnostic diagnostic;
+    bool failed = false;
+    const auto add = [&] {
+        failed = failed || !diagnostic.warning;
+        diagnostics.push_back(std::move(diagnostic));
+    };
+
+    // Label definitions, and references with the line and column of each
+    struct LabelRef {
+        unsigned int line;
+        unsigned int column;
+        std::string_view label;
+    };
+    std::unordered_map<std::string_view, unsigned int> label_defs;
+    std::vector<LabelRef> label_refs;
+
+    const char *const source_end =
+        program_source.data() + program_source.size();
+    unsigned int lineno = 0;
+
+    for (const char *first = program_source.data(); first < source_end;) {
+        const char *const last = scan_byte(first, source_end, '\n');
+        const std::string_view line(first, last - first);
+        const auto column = [&line](const Token &token) {
+            return static_cast<unsigned int>(token.token_data.data() -
+                                             line.data() + 1);
+        };
+        first = last + 1;
+        lineno++;
+
+        tokens.clear();
+        if (!tokenize(line, lineno, tokens, diagnostic) ||
+            (!tokens.empty() &&
+             !parse(tokens, line, lineno, instruction, diagnostic))) {
+            add();
+            continue;
+        }
+        if (tokens.empty()) {
+            continue;
+        }
+
+        const auto &paramemters = instruction.paramemters;
+        bool valid = true;
+
+        switch (instruction.ins_type) {
+        case InstructionType::LABEL:
+            if (!label_defs.emplace(paramemters[0].token_data, lineno)
+                     .second) {
+                valid = report(diagnostic, lineno, column(paramemters[0]),
+                               DiagnosticCode::LABEL_REDECLARED,
+                               "Label redeclaration error");
+                add();
+            }
+            break;
+
+        case InstructionType::JMP:
+        case InstructionType::JNE:
+        case InstructionType::JE:
+        case InstructionType::JGE:
+        case InstructionType::JG:
+        case InstructionType::JLE:
+        case InstructionType::JL:
+        case InstructionType::CALL:
+            label_refs.push_back({lineno, column(paramemters[0]),
+                                  paramemters[0].token_data});
+            break;
+
+        default:
+            for (const auto &paramemter : paramemters) {
+                const auto tok_data = paramemter.token_data;
+                int parsed_val = 0;
+
+                if (paramemter.token_type == TokenType::NUMBER &&
+                    std::from_chars(tok_data.data(),
+                                    tok_data.data() + tok_data.size(),
+                                    parsed_val)
+                            .ec != std::errc()) {
+                    report(diagnostic, lineno, column(paramemter),
+                           DiagnosticCode::INVALID_INTEGER,
+                           "Unable to convert string to integer!");
+                    diagnostic.warning = true;
+                    add();
+                    break;
+                }
+            }
+            break;
+        }
+
+        if (valid && generator != nullptr && !failed) {
+            generator->add(instruction, lineno);
+        }
+    }
+
+    // Linking
+    for (const auto &[line, column, label] : label_refs) {
+        if (label_defs.find(label) == label_defs.end()) {
+            report(diagnostic, line, column, DiagnosticCode::UNDEFINED_LABEL,
+                   "Undefined label " + std::string(label) + " referenced.");
+            add();
+        }
+    }
+
+    std::stable_sort(diagnostics.begin(), diagnostics.end(),
+                     [](const Diagnostic &lhs, const Diagnostic &rhs) {
+                         return lhs.line != rhs.line ? lhs.line < rhs.line
+                                                     : lhs.column < rhs.column;
+                     });
+    return !failed;
+}
+
+auto try_compile(const std::string_view &program_source,
+                 const OptimizerPasses &passes) -> CompileResult {
+    CompileResult result;
+    CodeGenerator generator;
+
+    if (check(program_source, &generator, result.diagnostics)) {
+        result.program = generator.finish(passes);
+    }
+
+    return result;
+}
+
+auto validate(const std::string_view &program_source)
+    -> std::vector<Diagnostic> {
+    std::vector<Diagnostic> diagnostics;
+    check(program_source, nullptr, diagnostics);
+    return diagnostics;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Optimizer.h"
+#include "Parser.h"
+#include "Program.h"
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Lexes, parses and generates the code of a whole source in one pass
+auto compile(const std::string_view &program_source) -> Program;
+
+// Same, then optimizes the code with the given passes
+auto compile(const std::string_view &program_source,
+             const OptimizerPasses &passes) -> Program;
+
+// What try_compile() makes of a source: the program if it has no errors,
+// and every error and warning found in it, in source order
+struct CompileResult {
+    std::optional<Program> program;
+    std::vector<Diagnostic> diagnostics;
+};
+
+// Same as compile(), but reports the errors of every line instead of
+// throwing at the first. Numbers out of the int range are warnings, the
+// program failing only if it runs them, as with compile().
+auto try_compile(const std::string_view &program_source,
+                 const OptimizerPasses &passes = {}) -> CompileResult;
+
+// Only checks a source, generating no code: the diagnostics try_compile()
+// would give for it
+auto validate(const std::string_view &program_source)
+    -> std::vector<Diagnostic>;
+
+// Opcode an instruction compiles to, END for labels which emit none
+auto to_opcode(const InstructionType &ins_type) -> OpCode;
+
+// The code generation stage of compile(), on its own so it can be driven,
+// and timed, separately. Instructions are added in source order; the text
+// their tokens point into must outlive the generator.
+class CodeGenerator {
+  public:
+    // Emits an instruction, or records a label definition
+    auto add(const Instruction &instruction, const unsigned int &lineno)
+        -> void;
+
+    // Resolves jump targets, optimizes with the given passes, then hands
+    // the finished program over
+    auto finish(const OptimizerPasses &passes = {}) -> Program;
+
+  private:
+    auto reg_slot(const std::string_view &reg) -> std::int32_t;
+
+    Program compiled;
+
+    // Label definitions, mapped to the index of the next emitted instruction
+    std::unordered_map<std::string_view, std::uint32_t> label_defs;
+
+    // Jumps and calls whose label is resolved once every label is known
+    std::vector<std::pair<size_t, std::string_view>> label_refs;
+
+    // Register allocation: every register name gets a dense slot
+    std::unordered_map<std::string_view, std::int32_t> reg_slots;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <utility>
+
+// What is wrong with a source, one code per message the throwing path
+// can give for it
+enum class DiagnosticCode {
+    UNMATCHED_QUOTE,     // A string is never closed
+    UNKNOWN_TOKEN,       // A character no token starts with
+    EXPECTED_COMA,       // Two operands without ',' between them
+    UNEXPECTED_TOKEN,    // Something other than an operand, e.g. ',' ','
+    NO_INSTRUCTION,      // The line doesn't start with a name
+    UNKNOWN_INSTRUCTION, // Neither a mnemonic nor a label
+    ARGUMENT_COUNT,      // Too many or too few operands
+    INVALID_ARGUMENT,    // An operand of a kind the instruction doesn't take
+    INVALID_INTEGER,     // A number out of the int range, a warning as
+                         // the program only fails if it runs
+    LABEL_REDECLARED,
+    UNDEFINED_LABEL
+};
+
+// An error in a source, as the non-throwing path reports it
+struct Diagnostic {
+    unsigned int line = 0;   // From 1
+    unsigned int column = 0; // From 1, of what it is about; 0 if unknown
+    DiagnosticCode code = DiagnosticCode::UNKNOWN_TOKEN;
+    std::string message;  // What the throwing path says, without the line
+    bool warning = false; // The source still compiles
+};
+
+// Fills in diagnostic, for functions reporting an error by returning false
+inline auto report(Diagnostic &diagnostic, const unsigned int &line,
+                   const unsigned int &column, const DiagnosticCode &code,
+                   std::string message) -> bool {
+    diagnostic.line = line;
+    diagnostic.column = column;
+    diagnostic.code = code;
+    diagnostic.message = std::move(message);
+    diagnostic.warning = false;
+    return false;
+}
@@ -0,0 +1,763 @@
+#include "Jit.h"
+#include "Errors.h"
+#include "Machine.h"
+#include "Optimizer.h"
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if ASMINTERP_JIT && defined(__x86_64__) && defined(__linux__)
+#define HAS_NATIVE_CODE 1
+#include <sys/mman.h>
+#include <unistd.h>
+#else
+#define HAS_NATIVE_CODE 0
+#endif
+
+auto native_code_supported() noexcept -> bool { return HAS_NATIVE_CODE; }
+
+#if HAS_NATIVE_CODE
+
+namespace {
+
+// How generated code leaves, in eax
+enum Status : int {
+    HALTED = 0,
+    ENDED = 1,
+    UNDEFINED_REGISTER,
+    DIVISION_BY_ZERO,
+    NOWHERE_TO_RETURN,
+    INVALID_INTEGER,
+    RAISED, // A runtime call threw, see Runtime::error
+};
+
+struct Runtime;
+
+// What generated code reads and writes, always in r15. Standard layout, the
+// code addresses fields by offsetof().
+struct Frame {
+    int *values;
+    std::uint8_t *defined;
+    std::uintptr_t *stack_base; // Return stack of native code addresses
+    std::uintptr_t *stack_limit;
+    std::uint32_t error_line;
+    std::int32_t error_slot;
+    std::int32_t cmp_test; // Handed back by runtime_closed_loop
+    Runtime *runtime;
+};
+
+// The C++ side of a run, for the runtime calls
+struct Runtime {
+    const Program &program;
+    RegisterFile &regs;
+    OutputSink &output;
+    std::string &message;
+    std::vector<std::uintptr_t> stack;
+    std::exception_ptr error;
+};
+
+using Entry = int (*)(Frame *);
+
+// Called by 'msg'. Returns 0, or RAISED with the exception in the runtime.
+auto runtime_msg(Frame *frame, std::uint32_t index) noexcept -> int {
+    Runtime &runtime = *frame->runtime;
+    const Program &program = runtime.program;
+    const Op &op = program.code[index];
+
+    try {
+        runtime.message.clear();
+        for (auto arg = program.msg_args.begin() + op.target,
+                  last = arg + op.a;
+             arg != last; arg++) {
+            if (arg->kind == OperandKind::STR) {
+                runtime.message.append(program.strings, arg->value,
+                                       arg->size);
+            } else {
+                char digits[16];
+                const auto [end, ec] = std::to_chars(
+                    digits, digits + sizeof(digits),
+                    runtime.regs.read(arg->kind, arg->value, op.line));
+                runtime.message.append(digits, end);
+            }
+        }
+        runtime.output.write(runtime.message);
+    } catch (...) {
+        runtime.error = std::current_exception();
+        return RAISED;
+    }
+
+    return 0;
+}
+
+// Called by CLOSED_LOOP. Returns whether it ran the loop, leaving cmp_test
+// in the frame.
+auto runtime_closed_loop(Frame *frame, std::uint32_t index) noexcept -> int {
+    const Program &program = frame->runtime->program;
+    int cmp_test = 0;
+
+    if (run_closed_loop(program, program.loops[program.code[index].target],
+                        frame->values, frame->defined, cmp_test,
+                        UINT64_MAX) == 0) {
+        return 0;
+    }
+
+    frame->cmp_test = cmp_test;
+    return 1;
+}
+
+// Called by 'call' on a full return stack with its top. Returns the new
+// top, or nullptr with the exception in the runtime.
+auto runtime_grow_stack(Frame *frame, std::uintptr_t *top) noexcept
+    -> std::uintptr_t * {
+    Runtime &runtime = *frame->runtime;
+    auto &stack = runtime.stack;
+    const size_t used = top - stack.data();
+
+    try {
+        stack.resize(stack.size() * 2);
+    } catch (...) {
+        runtime.error = std::current_exception();
+        return nullptr;
+    }
+
+    frame->stack_base = stack.data();
+    frame->stack_limit = stack.data() + stack.size();
+    return stack.data() + used;
+}
+
+// x86-64 registers, by encoding
+enum Reg : std::uint8_t {
+    RAX = 0,
+    RCX = 1,
+    RDX = 2,
+    RBX = 3,
+    RSP = 4,
+    RBP = 5,
+    RSI = 6,
+    RDI = 7,
+    R12 = 12,
+    R13 = 13,
+    R14 = 14,
+    R15 = 15,
+};
+
+// Condition codes, as in the low nibble of jcc
+enum Cond : std::uint8_t {
+    BELOW = 0x2,
+    ABOVE_EQUAL = 0x3,
+    EQUAL = 0x4,
+    NOT_EQUAL = 0x5,
+    LESS = 0xc,
+    GREATER_EQUAL = 0xd,
+    LESS_EQUAL = 0xe,
+    GREATER = 0xf,
+};
+
+// Register roles in generated code. All are callee saved, so runtime calls
+// keep them.
+constexpr Reg VALUES = RBX;   // RegisterFile::values
+constexpr Reg DEFINED = R13;  // RegisterFile::defined
+constexpr Reg CMP_TEST = R12; // Result of the last 'cmp'
+constexpr Reg STACK = R14;    // Top of the return stack
+constexpr Reg FRAME = R15;
+
+// Just the encodings the translator needs. Memory operands are always
+// [base + disp32], with a base other than rsp and r12.
+class Assembler {
+  public:
+    std::vector<std::uint8_t> bytes;
+
+    auto offset() const -> size_t { return bytes.size(); }
+
+    auto byte(const std::uint8_t &b) -> void { bytes.push_back(b); }
+
+    auto u32(const std::uint32_t &value) -> void {
+        for (int i = 0; i < 32; i += 8) {
+            byte(static_cast<std::uint8_t>(value >> i));
+        }
+    }
+
+    auto u64(const std::uint64_t &value) -> void {
+        u32(static_cast<std::uint32_t>(value));
+        u32(static_cast<std::uint32_t>(value >> 32));
+    }
+
+    auto rex(const bool &wide, const int &reg, const int &rm) -> void {
+        const std::uint8_t prefix = 0x40 | (wide ? 8 : 0) |
+                                    ((reg >> 3) << 2) | (rm >> 3);
+        if (prefix != 0x40) {
+            byte(prefix);
+        }
+    }
+
+    auto mem(const int &reg, const Reg &base, const std::int32_t &disp)
+        -> void {
+        byte(static_cast<std::uint8_t>(0x80 | (reg & 7) << 3 | (base & 7)));
+        u32(static_cast<std::uint32_t>(disp));
+    }
+
+    auto direct(const int &reg, const int &rm) -> void {
+        byte(static_cast<std::uint8_t>(0xc0 | (reg & 7) << 3 | (rm & 7)));
+    }
+
+    // opcode reg, [base + disp] or opcode [base + disp], reg
+    auto op_mem(const bool &wide, const std::uint8_t &opcode, const int &reg,
+                const Reg &base, const std::int32_t &disp) -> void {
+        rex(wide, reg, base);
+        byte(opcode);
+        mem(reg, base, disp);
+    }
+
+    // opcode rm, reg
+    auto op_reg(const bool &wide, const std::uint8_t &opcode, const int &reg,
+                const int &rm) -> void {
+        rex(wide, reg, rm);
+        byte(opcode);
+        direct(reg, rm);
+    }
+
+    auto push(const Reg &reg) -> void {
+        rex(false, 0, reg);
+        byte(0x50 | (reg & 7));
+    }
+
+    auto pop(const Reg &reg) -> void {
+        rex(false, 0, reg);
+        byte(0x58 | (reg & 7));
+    }
+
+    auto mov_imm32(const Reg &reg, const std::int32_t &imm) -> void {
+        rex(false, 0, reg);
+        byte(0xb8 | (reg & 7));
+        u32(static_cast<std::uint32_t>(imm));
+    }
+
+    auto mov_imm64(const Reg &reg, const std::uint64_t &imm) -> void {
+        rex(true, 0, reg);
+        byte(0xb8 | (reg & 7));
+        u64(imm);
+    }
+
+    // group 1 (add /0, sub /5, cmp /7) dword [base + disp], imm32
+    auto alu_mem_imm(const int &ext, const Reg &base,
+                     const std::int32_t &disp, const std::int32_t &imm)
+        -> void {
+        op_mem(false, 0x81, ext, base, disp);
+        u32(static_cast<std::uint32_t>(imm));
+    }
+
+    // group 1 reg32, imm32
+    auto alu_reg_imm(const int &ext, const Reg &reg, const std::int32_t &imm)
+        -> void {
+        op_reg(false, 0x81, ext, reg);
+        u32(static_cast<std::uint32_t>(imm));
+    }
+
+    // rel32 jumps, returning where to patch the displacement
+    auto jmp() -> size_t {
+        byte(0xe9);
+        u32(0);
+        return offset() - 4;
+    }
+
+    auto jcc(const Cond &cond) -> size_t {
+        byte(0x0f);
+        byte(0x80 | cond);
+        u32(0);
+        return offset() - 4;
+    }
+
+    // Points a rel32 at 'where' to 'target'
+    auto patch(const size_t &where, const size_t &target) -> void {
+        const auto rel = static_cast<std::uint32_t>(
+            static_cast<std::int64_t>(target) -
+            static_cast<std::int64_t>(where + 4));
+        std::memcpy(bytes.data() + where, &rel, 4);
+    }
+
+    template <typename Function> auto call(Function *function) -> void {
+        mov_imm64(RAX, reinterpret_cast<std::uintptr_t>(function));
+        byte(0xff); // call rax
+        direct(2, RAX);
+    }
+};
+
+constexpr auto value_disp(const std::int32_t &slot) -> std::int32_t {
+    return slot * static_cast<std::int32_t>(sizeof(int));
+}
+
+constexpr auto frame_disp(const size_t &offset) -> std::int32_t {
+    return static_cast<std::int32_t>(offset);
+}
+
+class Translator {
+  public:
+    explicit Translator(const Program &program)
+        : program(program), labels(program.code.size()),
+          leaders(find_leaders(program)),
+          checked(program.reg_names.size(), 0) {}
+
+    auto translate() -> std::vector<std::uint8_t>;
+
+  private:
+    struct Stub {
+        size_t jump;       // rel32 to point at the stub
+        Status status;
+        std::int32_t slot; // UNDEFINED_REGISTER only
+        std::uint32_t line;
+    };
+
+    auto prologue() -> void;
+    auto epilogue() -> void;
+    auto translate(const size_t &index, const Op &op) -> void;
+    auto check_defined(const std::int32_t &slot, const std::uint32_t &line)
+        -> void;
+    auto load(const Reg &reg, const OperandKind &kind,
+              const std::int32_t &value, const std::uint32_t &line) -> void;
+    auto jump_to(const size_t &jump, const std::uint32_t &target) -> void {
+        jumps.emplace_back(jump, target);
+    }
+    auto fail(const size_t &jump, const Status &status,
+              const std::uint32_t &line, const std::int32_t &slot = 0)
+        -> void {
+        stubs.push_back({jump, status, slot, line});
+    }
+
+    // Whether the instruction being translated needs the OpCheck
+    auto needs(const std::uint8_t &check) const -> bool {
+        return !program.verified || (current->checks & check) != 0;
+    }
+    // Whether verify() proved slot defined before it runs
+    auto proven(const std::int32_t &slot) const -> bool {
+        return (current->code != OpCode::MOV && // Which never reads its a
+                current->a_kind == OperandKind::REG && current->a == slot &&
+                !needs(CHECK_A)) ||
+               (current->b_kind == OperandKind::REG && current->b == slot &&
+                !needs(CHECK_B));
+    }
+
+    const Program &program;
+    Assembler as;
+    std::vector<size_t> labels; // Code offset of every instruction
+    std::vector<bool> leaders;  // Instructions reachable other than in order
+    std::vector<std::pair<size_t, std::uint32_t>> jumps; // To instructions
+    std::vector<std::pair<size_t, size_t>> returns;      // lea of each call
+    std::vector<Stub> stubs;
+    std::vector<size_t> to_epilogue;
+    std::vector<size_t> to_raised;
+
+    // Registers known to be defined since the current basic block started.
+    // A register is checked in block n if checked[slot] == n.
+    std::vector<std::uint32_t> checked;
+    std::uint32_t block = 1;
+
+    const Op *current = nullptr; // Being translated
+};
+
+auto Translator::prologue() -> void {
+    // Six pushes and the return address keep rsp 16 byte aligned for the
+    // runtime calls after 'sub rsp, 8'
+    for (const Reg reg : {RBP, RBX, R12, R13, R14, R15}) {
+        as.push(reg);
+    }
+    as.byte(0x48); // sub rsp, 8
+    as.byte(0x83);
+    as.direct(5, RSP);
+    as.byte(8);
+
+    as.op_reg(true, 0x89, RDI, FRAME); // mov r15, rdi
+    as.op_mem(true, 0x8b, VALUES, FRAME, frame_disp(offsetof(Frame, values)));
+    as.op_mem(true, 0x8b, DEFINED, FRAME,
+              frame_disp(offsetof(Frame, defined)));
+    as.op_mem(true, 0x8b, STACK, FRAME,
+              frame_disp(offsetof(Frame, stack_base)));
+    as.op_reg(false, 0x31, CMP_TEST, CMP_TEST); // xor r12d, r12d
+}
+
+auto Translator::epilogue() -> void {
+    as.byte(0x48); // add rsp, 8
+    as.byte(0x83);
+    as.direct(0, RSP);
+    as.byte(8);
+    for (const Reg reg : {R15, R14, R13, R12, RBX, RBP}) {
+        as.pop(reg);
+    }
+    as.byte(0xc3); // ret
+}
+
+auto Translator::check_defined(const std::int32_t &slot,
+                               const std::uint32_t &line) -> void {
+    if (checked[slot] == block || proven(slot)) {
+        return;
+    }
+
+    // cmp byte [r13 + slot], 0
+    as.op_mem(false, 0x80, 7, DEFINED, slot);
+    as.byte(0);
+    fail(as.jcc(EQUAL), UNDEFINED_REGISTER, line, slot);
+    checked[slot] = block;
+}
+
+// Loads an operand into a 32 bit register
+auto Translator::load(const Reg &reg, const OperandKind &kind,
+                      const std::int32_t &value, const std::uint32_t &line)
+    -> void {
+    if (kind == OperandKind::IMM) {
+        as.mov_imm32(reg, value);
+        return;
+    }
+
+    check_defined(value, line);
+    as.op_mem(false, 0x8b, reg, VALUES, value_disp(value));
+}
+
+auto Translator::translate(const size_t &index, const Op &op) -> void {
+    current = &op;
+    const auto a = value_disp(op.a);
+    const bool b_imm = op.b_kind == OperandKind::IMM;
+
+    // Flags left by 'test r12d, r12d' decide every conditional jump
+    const auto branch = [&](const Cond &cond) {
+        as.op_reg(false, 0x85, CMP_TEST, CMP_TEST);
+        jump_to(as.jcc(cond), op.target);
+    };
+
+    // Two operand arithmetic: the source is read before the destination
+    const auto arithmetic = [&](const std::uint8_t &mem_reg_opcode,
+                                const int &ext) {
+        if (b_imm) {
+            check_defined(op.a, op.line);
+            as.alu_mem_imm(ext, VALUES, a, op.b);
+        } else {
+            load(RAX, op.b_kind, op.b, op.line);
+            check_defined(op.a, op.line);
+            as.op_mem(false, mem_reg_opcode, RAX, VALUES, a);
+        }
+    };
+
+    switch (unfused(op.code)) {
+    case OpCode::MOV:
+        load(RAX, op.b_kind, op.b, op.line);
+        as.op_mem(false, 0x89, RAX, VALUES, a);
+        if (checked[op.a] != block) {
+            // mov byte [r13 + a], 1
+            as.op_mem(false, 0xc6, 0, DEFINED, op.a);
+            as.byte(1);
+            checked[op.a] = block;
+        }
+        break;
+
+    case OpCode::INC:
+    case OpCode::DEC:
+        check_defined(op.a, op.line);
+        as.op_mem(false, 0xff, unfused(op.code) == OpCode::INC ? 0 : 1,
+                  VALUES, a);
+        break;
+
+    case OpCode::ADD:
+        arithmetic(0x01, 0);
+        break;
+
+    case OpCode::SUB:
+        arithmetic(0x29, 5);
+        break;
+
+    case OpCode::MUL:
+        if (b_imm) {
+            check_defined(op.a, op.line);
+            as.op_mem(false, 0x69, RAX, VALUES, a); // imul eax, [a], imm32
+            as.u32(static_cast<std::uint32_t>(op.b));
+        } else {
+            load(RCX, op.b_kind, op.b, op.line);
+            check_defined(op.a, op.line);
+            as.op_mem(false, 0x8b, RAX, VALUES, a);
+            as.byte(0x0f); // imul eax, ecx
+            as.byte(0xaf);
+            as.direct(RAX, RCX);
+        }
+        as.op_mem(false, 0x89, RAX, VALUES, a);
+        break;
+
+    case OpCode::DIV:
+        if (b_imm && op.b == 0) {
+            fail(as.jmp(), DIVISION_BY_ZERO, op.line);
+            break;
+        }
+        load(RCX, op.b_kind, op.b, op.line);
+        if (!b_imm && needs(CHECK_DIVISOR)) {
+            as.op_reg(false, 0x85, RCX, RCX); // test ecx, ecx
+            fail(as.jcc(EQUAL), DIVISION_BY_ZERO, op.line);
+        }
+        check_defined(op.a, op.line);
+        as.op_mem(false, 0x8b, RAX, VALUES, a);
+        as.byte(0x99); // cdq
+        as.op_reg(false, 0xf7, 7, RCX); // idiv ecx
+        as.op_mem(false, 0x89, RAX, VALUES, a);
+        break;
+
+    case OpCode::CMP:
+        // Jumps test the sign of the wrapped difference, like the
+        // interpreter, not the comparison itself
+        load(CMP_TEST, op.a_kind, op.a, op.line);
+        if (b_imm) {
+            as.alu_reg_imm(5, CMP_TEST, op.b);
+        } else {
+            check_defined(op.b, op.line);
+            as.op_mem(false, 0x2b, CMP_TEST, VALUES, value_disp(op.b));
+        }
+        break;
+
+    case OpCode::JMP:
+        jump_to(as.jmp(), op.target);
+        break;
+
+    case OpCode::JNE:
+        branch(NOT_EQUAL);
+        break;
+
+    case OpCode::JE:
+        branch(EQUAL);
+        break;
+
+    case OpCode::JGE:
+        branch(GREATER_EQUAL);
+        break;
+
+    case OpCode::JG:
+        branch(GREATER);
+        break;
+
+    case OpCode::JLE:
+        branch(LESS_EQUAL);
+        break;
+
+    case OpCode::JL:
+        branch(LESS);
+        break;
+
+    case OpCode::CALL: {
+        // cmp r14, [r15 + stack_limit]
+        as.op_mem(true, 0x3b, STACK, FRAME,
+                  frame_disp(offsetof(Frame, stack_limit)));
+        const size_t full = as.jcc(ABOVE_EQUAL);
+        const size_t resume = as.offset();
+
+        // lea rax, [rip + return address]
+        as.byte(0x48);
+        as.byte(0x8d);
+        as.byte(0x05);
+        as.u32(0);
+        returns.emplace_back(as.offset() - 4, index + 1);
+
+        as.rex(true, RAX, STACK); // mov [r14], rax
+        as.byte(0x89);
+        as.byte(static_cast<std::uint8_t>((RAX & 7) << 3 | (STACK & 7)));
+        as.op_reg(true, 0x83, 0, STACK); // add r14, 8
+        as.byte(8);
+        jump_to(as.jmp(), op.target);
+
+        // Out of line: grow the stack, then push as usual
+        const size_t grow = as.offset();
+        as.patch(full, grow);
+        as.op_reg(true, 0x89, FRAME, RDI); // mov rdi, r15
+        as.op_reg(true, 0x89, STACK, RSI); // mov rsi, r14
+        as.call(&runtime_grow_stack);
+        as.op_reg(true, 0x85, RAX, RAX); // test rax, rax
+        to_raised.push_back(as.jcc(EQUAL));
+        as.op_reg(true, 0x89, RAX, STACK); // mov r14, rax
+        as.patch(as.jmp(), resume);
+        break;
+    }
+
+    case OpCode::RET:
+        if (needs(CHECK_STACK)) {
+            // cmp r14, [r15 + stack_base]
+            as.op_mem(true, 0x3b, STACK, FRAME,
+                      frame_disp(offsetof(Frame, stack_base)));
+            fail(as.jcc(EQUAL), NOWHERE_TO_RETURN, op.line);
+        }
+        as.op_reg(true, 0x83, 5, STACK); // sub r14, 8
+        as.byte(8);
+        as.rex(false, 0, STACK); // jmp [r14]
+        as.byte(0xff);
+        as.byte(static_cast<std::uint8_t>(4 << 3 | (STACK & 7)));
+        break;
+
+    case OpCode::MSG:
+        as.op_reg(true, 0x89, FRAME, RDI); // mov rdi, r15
+        as.mov_imm32(RSI, static_cast<std::int32_t>(index));
+        as.call(&runtime_msg);
+        as.op_reg(false, 0x85, RAX, RAX); // test eax, eax
+        to_epilogue.push_back(as.jcc(NOT_EQUAL));
+        break;
+
+    case OpCode::CLOSED_LOOP: {
+        as.op_reg(true, 0x89, FRAME, RDI); // mov rdi, r15
+        as.mov_imm32(RSI, static_cast<std::int32_t>(index));
+        as.call(&runtime_closed_loop);
+        as.op_reg(false, 0x85, RAX, RAX); // test eax, eax
+        const size_t loop = as.jcc(EQUAL);
+        // mov r12d, [r15 + cmp_test]
+        as.op_mem(false, 0x8b, CMP_TEST, FRAME,
+                  frame_disp(offsetof(Frame, cmp_test)));
+        jump_to(as.jmp(), program.loops[op.target].exit);
+        as.patch(loop, as.offset());
+        break;
+    }
+
+    case OpCode::END:
+        as.mov_imm32(RAX, ENDED);
+        to_epilogue.push_back(as.jmp());
+        break;
+
+    case OpCode::INVALID_INTEGER:
+        if (needs(CHECK_A)) {
+            for (auto arg = program.msg_args.begin() + op.target,
+                      last = arg + op.a;
+                 arg != last; arg++) {
+                if (arg->kind == OperandKind::REG) {
+                    check_defined(arg->value, op.line);
+                }
+            }
+        }
+        fail(as.jmp(), INVALID_INTEGER, op.line);
+        break;
+
+    default: // HALT
+        as.mov_imm32(RAX, HALTED);
+        to_epilogue.push_back(as.jmp());
+        break;
+    }
+}
+
+auto Translator::translate() -> std::vector<std::uint8_t> {
+    prologue();
+
+    for (size_t i = 0; i < program.code.size(); i++) {
+        if (leaders[i]) {
+            block++;
+        }
+        labels[i] = as.offset();
+        translate(i, program.code[i]);
+    }
+
+    // Out of line error exits, then the single way out
+    for (const auto &stub : stubs) {
+        as.patch(stub.jump, as.offset());
+        as.op_mem(false, 0xc7, 0, FRAME,
+                  frame_disp(offsetof(Frame, error_slot)));
+        as.u32(static_cast<std::uint32_t>(stub.slot));
+        as.op_mem(false, 0xc7, 0, FRAME,
+                  frame_disp(offsetof(Frame, error_line)));
+        as.u32(stub.line);
+        as.mov_imm32(RAX, stub.status);
+        to_epilogue.push_back(as.jmp());
+    }
+
+    const size_t raised = as.offset();
+    as.mov_imm32(RAX, RAISED);
+
+    const size_t exit = as.offset();
+    epilogue();
+
+    for (const auto &[jump, target] : jumps) {
+        as.patch(jump, labels[target]);
+    }
+    for (const auto &[lea, index] : returns) {
+        as.patch(lea, labels[index]);
+    }
+    for (const auto &jump : to_raised) {
+        as.patch(jump, raised);
+    }
+    for (const auto &jump : to_epilogue) {
+        as.patch(jump, exit);
+    }
+
+    return std::move(as.bytes);
+}
+
+} // namespace
+
+NativeCode::NativeCode(const Program &program) : program(program) {
+    const auto bytes = Translator(program).translate();
+
+    // Written then made executable, never both
+    const auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    code_size = bytes.size();
+    mapped_size = (code_size + page - 1) / page * page;
+
+    code = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED) {
+        code = nullptr;
+        throw std::runtime_error("Unable to map memory for native code");
+    }
+
+    std::memcpy(code, bytes.data(), code_size);
+    if (mprotect(code, mapped_size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(code, mapped_size);
+        code = nullptr;
+        throw std::runtime_error("Unable to make native code executable");
+    }
+}
+
+NativeCode::~NativeCode() {
+    if (code != nullptr) {
+        munmap(code, mapped_size);
+    }
+}
+
+auto NativeCode::run(RegisterFile &regs, OutputSink &output,
+                     std::string &message) const -> bool {
+    Runtime runtime{program, regs, output, message, {}, {}};
+    runtime.stack.resize(256);
+
+    Frame frame{regs.values.data(),
+                regs.defined.data(),
+                runtime.stack.data(),
+                runtime.stack.data() + runtime.stack.size(),
+                0,
+                0,
+                0,
+                &runtime};
+
+    switch (reinterpret_cast<Entry>(code)(&frame)) {
+    case HALTED:
+        return false;
+    case ENDED:
+        return true;
+    case UNDEFINED_REGISTER:
+        PARSE_ERR(frame.error_line, "Unknown register " +
+                                        program.reg_names[frame.error_slot] +
+                                        " accessed.");
+    case DIVISION_BY_ZERO:
+        PARSE_ERR(frame.error_line, "Division by Zero");
+    case NOWHERE_TO_RETURN:
+        PARSE_ERR(frame.error_line, "Nowhere to return!");
+    case INVALID_INTEGER:
+        PARSE_ERR(frame.error_line, "Unable to convert string to integer!");
+    default:
+        std::rethrow_exception(runtime.error);
+    }
+}
+
+#else
+
+NativeCode::NativeCode(const Program &program) : program(program) {
+    throw std::runtime_error("Native code is not supported on this host");
+}
+
+NativeCode::~NativeCode() = default;
+
+auto NativeCode::run(RegisterFile &, OutputSink &, std::string &) const
+    -> bool {
+    return false;
+}
+
+#endif
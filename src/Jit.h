@@ -0,0 +1,43 @@
+#pragma once
+
+#include "OutputSink.h"
+#include "Program.h"
+
+#include <cstddef>
+#include <string>
+
+struct RegisterFile;
+
+// Whether this build can translate programs to native code: x86-64 Linux,
+// with ASMINTERP_JIT enabled.
+auto native_code_supported() noexcept -> bool;
+
+// A Program translated to x86-64 machine code, in executable pages of its
+// own. Registers stay in the RegisterFile of the run, the comparison result
+// lives in a machine register, 'call' and 'ret' go through a return stack
+// separate from the native one, and 'msg' and errors call back into C++.
+// Runs behave exactly like the interpreter's, errors included.
+class NativeCode {
+  public:
+    // Throws if native code isn't supported, see native_code_supported()
+    explicit NativeCode(const Program &program);
+    ~NativeCode();
+
+    NativeCode(const NativeCode &) = delete;
+    auto operator=(const NativeCode &) -> NativeCode & = delete;
+
+    // Runs from the first instruction, on registers of the program it was
+    // made from. 'message' is the buffer each 'msg' is formatted in.
+    // Returns true if the program reached 'end', false if it ran off its end.
+    auto run(RegisterFile &regs, OutputSink &output,
+             std::string &message) const -> bool;
+
+    // Bytes of machine code generated
+    auto size() const noexcept -> size_t { return code_size; }
+
+  private:
+    const Program &program;
+    void *code = nullptr;
+    size_t code_size = 0;
+    size_t mapped_size = 0;
+};
@@ -0,0 +1,533 @@
+#include "LaneExecutor.h"
+#include "Machine.h"
+#include "Optimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <stack>
+
+// The lanes are GCC vectors, the engine is compiled for AVX2 and for the
+// baseline, one picked when the program loads
+#if defined(__GNUC__) && defined(__x86_64__)
+#define LANES_X86 1
+#include <immintrin.h>
+#else
+#define LANES_X86 0
+#endif
+
+#if LANES_X86 && defined(__linux__)
+#define LANE_TARGETS __attribute__((target_clones("avx2", "default")))
+#else
+#define LANE_TARGETS
+#endif
+
+namespace {
+
+// A value per lane, wrapping around like the engines' int arithmetic.
+// Aligned explicitly, the baseline would only align it to 16 bytes, which
+// AVX2 loads fault on.
+#define LANE_VECTOR __attribute__((vector_size(lane_count * 4), aligned(32)))
+using Lanes = std::uint32_t LANE_VECTOR;
+// -1 in the lanes where something holds, 0 in the others, as comparisons
+// give it. Also the lanes as signed values, to compare against 0.
+using Mask = std::int32_t LANE_VECTOR;
+#undef LANE_VECTOR
+// The lanes as doubles, to divide
+using Wide = double __attribute__((vector_size(lane_count * 8)));
+
+// Pc of lanes not running here, past every instruction
+constexpr std::uint32_t dead = UINT32_MAX;
+
+// Steps the lowest lane may run by itself before finishing on a Machine
+constexpr unsigned alone_limit = 256;
+
+// Bit per lane of a mask
+inline auto bits(const Mask &mask) -> unsigned {
+#if LANES_X86
+    // SSE, which every x86-64 has, so both builds of the engine can use it
+    const auto half = [&](const int &first) {
+        return static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(
+            _mm_set_epi32(mask[first + 3], mask[first + 2], mask[first + 1],
+                          mask[first]))));
+    };
+    return half(0) | half(4) << 4;
+#else
+    unsigned result = 0;
+    for (unsigned lane = 0; lane < lane_count; lane++) {
+        result |= (static_cast<unsigned>(mask[lane]) & 1) << lane;
+    }
+    return result;
+#endif
+}
+
+// A register, a lane per seeding. Kept in a struct, as a vector type loses
+// its alignment as a template argument.
+struct LaneRegister {
+    Lanes values{};
+    unsigned defined = 0; // Bit per lane
+};
+
+// Runs of up to lane_count seedings of a program, a lane each. Lanes not
+// running here hold whatever the others leave in them.
+struct Group {
+    Group(const Program &program,
+          const std::vector<std::pair<std::string, int>> *seeds,
+          BatchResult *results, const size_t &count);
+
+    // Whether any of lanes reads an operand of op, per check among CHECK_A
+    // and CHECK_B, undefined. Those finish on a Machine, which throws like
+    // the engines do.
+    auto fails(const Op &op, const unsigned &lanes,
+               const std::uint8_t &checks) -> bool {
+        unsigned failing = 0;
+        if (needs(op, checks & CHECK_A, op.a_kind)) {
+            failing |= lanes & ~regs[op.a].defined;
+        }
+        if (needs(op, checks & CHECK_B, op.b_kind)) {
+            failing |= lanes & ~regs[op.b].defined;
+        }
+        if (failing != 0) {
+            escape_all(failing);
+        }
+        return failing != 0;
+    }
+    auto needs(const Op &op, const int &check, const OperandKind &kind) const
+        -> bool {
+        return check != 0 && kind == OperandKind::REG &&
+               (!program.verified || (op.checks & check) != 0);
+    }
+
+    auto escape_all(const unsigned &lanes) -> void;
+
+    // Hands the lane over to a Machine at its pc, to run to its end
+    auto escape(const unsigned &lane) -> void;
+
+    // Ends the lane here, having reached 'end' or run off the program
+    auto finish(const unsigned &lane, const bool &ended) -> void;
+
+    auto retire(const unsigned &lane) -> void {
+        live &= ~(1U << lane);
+        pcs[lane] = dead;
+    }
+
+    const Program &program;
+    BatchResult *const results;
+
+    std::vector<LaneRegister> regs; // Per register slot
+    Lanes cmp_test{};
+    Lanes pcs{};
+    unsigned live = 0; // Bit per lane still running here
+    std::array<std::vector<size_t>, lane_count> stacks;
+    std::array<std::string, lane_count> outputs;
+
+    // One lane's registers, for run_closed_loop()
+    std::vector<int> lane_values;
+    std::vector<std::uint8_t> lane_defined;
+};
+
+Group::Group(const Program &program,
+             const std::vector<std::pair<std::string, int>> *seeds,
+             BatchResult *results, const size_t &count)
+    : program(program), results(results), regs(program.reg_names.size()),
+      lane_values(program.reg_names.size()),
+      lane_defined(program.reg_names.size()) {
+    pcs += dead;
+
+    for (unsigned lane = 0; lane < count; lane++) {
+        for (const auto &[name, value] : seeds[lane]) {
+            if (const auto slot = program.register_slot(name); slot >= 0) {
+                regs[slot].values[lane] = static_cast<std::uint32_t>(value);
+                regs[slot].defined |= 1U << lane;
+            }
+        }
+        live |= 1U << lane;
+        pcs[lane] = 0;
+    }
+}
+
+auto Group::escape_all(const unsigned &lanes) -> void {
+    for (unsigned lane = 0; lane < lane_count; lane++) {
+        if ((lanes >> lane) & 1) {
+            escape(lane);
+        }
+    }
+}
+
+auto Group::escape(const unsigned &lane) -> void {
+    Snapshot frozen;
+    frozen.program = &program;
+    frozen.pc = pcs[lane];
+    frozen.cmp_test = static_cast<int>(cmp_test[lane]);
+    for (const auto &reg : regs) {
+        frozen.values.push_back(static_cast<int>(reg.values[lane]));
+        frozen.defined.push_back((reg.defined >> lane) & 1);
+    }
+    frozen.stack = std::stack<size_t>(
+        std::deque<size_t>(stacks[lane].begin(), stacks[lane].end()));
+    frozen.output = std::make_shared<const std::string>(outputs[lane]);
+
+    BatchResult &result = results[lane];
+    try {
+        Machine machine(program);
+        machine.restore(frozen);
+        machine.resume();
+
+        result.output = machine.result();
+        for (const auto &name : program.reg_names) {
+            result.registers.push_back(machine.get_register(name));
+        }
+        result.ok = true;
+    } catch (const std::exception &e) {
+        result.error = e.what();
+    }
+
+    retire(lane);
+}
+
+auto Group::finish(const unsigned &lane, const bool &ended) -> void {
+    BatchResult &result = results[lane];
+
+    result.output = ended ? std::move(outputs[lane]) : "-1";
+    for (const auto &reg : regs) {
+        if ((reg.defined >> lane) & 1) {
+            result.registers.emplace_back(static_cast<int>(reg.values[lane]));
+        } else {
+            result.registers.emplace_back();
+        }
+    }
+    result.ok = true;
+
+    retire(lane);
+}
+
+// Lanes of an operand
+#define OPERAND(kind, value)                                                   \
+    ((kind) == OperandKind::IMM ? Lanes{} + static_cast<std::uint32_t>(value)  \
+                                : group.regs[value].values)
+
+// Runs the group until every lane has finished, here or on a Machine
+LANE_TARGETS auto run_group(Group &group) -> void {
+    const Program &program = group.program;
+    const Op *const code = program.code.data();
+
+    // While every live lane is at pc, it is followed here rather than
+    // looked for as the lowest pc of a lane
+    bool together = true;
+    std::uint32_t pc = 0;
+    unsigned alone = 0; // Steps a single lane ran by itself, in a row
+
+    while (group.live != 0) {
+        unsigned lanes = group.live; // At pc
+        if (!together) {
+            pc = group.pcs[0];
+            for (unsigned lane = 1; lane < lane_count; lane++) {
+                pc = std::min<std::uint32_t>(pc, group.pcs[lane]);
+            }
+            lanes = bits(group.pcs == pc);
+            together = lanes == group.live;
+        }
+        const Mask at = group.pcs == pc;
+
+        if ((lanes & (lanes - 1)) != 0) {
+            alone = 0;
+        } else if (++alone > alone_limit) {
+            group.escape(__builtin_ctz(lanes));
+            alone = 0;
+            together = false;
+            continue;
+        }
+
+        const Op &op = code[pc];
+
+        // The lanes at pc jump to the target where taken holds, and go on
+        // skip instructions ahead elsewhere
+#define BRANCH(taken, skip)                                                    \
+    do {                                                                       \
+        const Mask jumping = at & (taken);                                     \
+        group.pcs = jumping ? Lanes{} + op.target                              \
+                    : at    ? Lanes{} + (pc + (skip))                          \
+                            : group.pcs;                                       \
+        if (together) {                                                        \
+            if (const auto jumped = bits(jumping); jumped == lanes) {          \
+                pc = op.target;                                                \
+            } else if (jumped == 0) {                                          \
+                pc += (skip);                                                  \
+            } else {                                                           \
+                together = false;                                              \
+            }                                                                  \
+        }                                                                      \
+    } while (false)
+
+        switch (op.code) {
+        case OpCode::MOV: {
+            if (group.fails(op, lanes, CHECK_B)) {
+                continue;
+            }
+            LaneRegister &a = group.regs[op.a];
+            a.values = at ? OPERAND(op.b_kind, op.b) : a.values;
+            a.defined |= lanes;
+            break;
+        }
+
+        case OpCode::INC:
+        case OpCode::DEC:
+            if (group.fails(op, lanes, CHECK_A)) {
+                continue;
+            }
+            group.regs[op.a].values +=
+                Lanes(op.code == OpCode::INC ? -at : at);
+            break;
+
+        case OpCode::ADD:
+        case OpCode::SUB:
+        case OpCode::MUL:
+        case OpCode::CMP: {
+            if (group.fails(op, lanes, CHECK_A | CHECK_B)) {
+                continue;
+            }
+            const Lanes b = OPERAND(op.b_kind, op.b);
+            if (op.code == OpCode::CMP) {
+                group.cmp_test =
+                    at ? OPERAND(op.a_kind, op.a) - b : group.cmp_test;
+            } else {
+                Lanes &a = group.regs[op.a].values;
+                a = at ? (op.code == OpCode::ADD   ? a + b
+                          : op.code == OpCode::SUB ? a - b
+                                                   : a * b)
+                       : a;
+            }
+            break;
+        }
+
+        case OpCode::DIV: {
+            if (group.fails(op, lanes, CHECK_A | CHECK_B)) {
+                continue;
+            }
+            const Mask b = Mask(OPERAND(op.b_kind, op.b));
+            Lanes &a = group.regs[op.a].values;
+
+            // Dividing by zero, or INT_MIN by -1, fails or traps like on
+            // the engines
+            const Mask overflows = (Mask(a) == INT32_MIN) & (b == -1);
+            if (const auto failing = lanes & bits((b == 0) | overflows);
+                failing != 0) {
+                group.escape_all(failing);
+                continue;
+            }
+
+            // Exact in doubles, with dividends far below 2^53
+            const Wide quotient =
+                __builtin_convertvector(Mask(a), Wide) /
+                __builtin_convertvector(at ? b : Mask{} + 1, Wide);
+            a = at ? Lanes(__builtin_convertvector(quotient, Mask)) : a;
+            break;
+        }
+
+        case OpCode::JMP:
+            group.pcs = at ? Lanes{} + op.target : group.pcs;
+            pc = op.target;
+            continue;
+
+#define JUMP(name, condition)                                                  \
+    case OpCode::name:                                                         \
+        BRANCH(Mask(group.cmp_test) condition 0, 1);                           \
+        continue;
+
+            JUMP(JNE, !=)
+            JUMP(JE, ==)
+            JUMP(JGE, >=)
+            JUMP(JG, >)
+            JUMP(JLE, <=)
+            JUMP(JL, <)
+#undef JUMP
+
+        case OpCode::CALL:
+            for (unsigned lane = 0; lane < lane_count; lane++) {
+                if ((lanes >> lane) & 1) {
+                    group.stacks[lane].push_back(pc + 1);
+                }
+            }
+            group.pcs = at ? Lanes{} + op.target : group.pcs;
+            pc = op.target;
+            continue;
+
+        case OpCode::RET:
+            for (unsigned lane = 0; lane < lane_count; lane++) {
+                if (((lanes >> lane) & 1) == 0) {
+                    continue;
+                }
+                if (auto &stack = group.stacks[lane]; stack.empty()) {
+                    group.escape(lane); // Nowhere to return
+                } else {
+                    group.pcs[lane] = static_cast<std::uint32_t>(stack.back());
+                    stack.pop_back();
+                }
+            }
+            together = false;
+            continue;
+
+        case OpCode::MSG: {
+            const auto first = program.msg_args.begin() + op.target;
+            const auto last = first + op.a;
+            for (unsigned lane = 0; lane < lane_count; lane++) {
+                if (((lanes >> lane) & 1) == 0) {
+                    continue;
+                }
+                if (std::any_of(first, last, [&](const MsgArg &arg) {
+                        return arg.kind == OperandKind::REG &&
+                               ((group.regs[arg.value].defined >> lane) & 1) ==
+                                   0;
+                    })) {
+                    group.escape(lane); // Unknown register
+                    continue;
+                }
+
+                std::string &output = group.outputs[lane];
+                for (auto arg = first; arg != last; arg++) {
+                    if (arg->kind == OperandKind::STR) {
+                        output.append(program.strings, arg->value, arg->size);
+                    } else {
+                        char digits[16];
+                        const auto [end, ec] = std::to_chars(
+                            digits, digits + sizeof(digits),
+                            arg->kind == OperandKind::IMM
+                                ? arg->value
+                                : static_cast<int>(
+                                      group.regs[arg->value].values[lane]));
+                        output.append(digits, end);
+                    }
+                }
+            }
+            break;
+        }
+
+        case OpCode::CLOSED_LOOP: {
+            const ClosedLoop &loop = program.loops[op.target];
+            for (unsigned lane = 0; lane < lane_count; lane++) {
+                if (((lanes >> lane) & 1) == 0) {
+                    continue;
+                }
+                for (size_t slot = 0; slot < group.regs.size(); slot++) {
+                    const LaneRegister &reg = group.regs[slot];
+                    group.lane_values[slot] =
+                        static_cast<int>(reg.values[lane]);
+                    group.lane_defined[slot] = (reg.defined >> lane) & 1;
+                }
+                int lane_cmp_test = static_cast<int>(group.cmp_test[lane]);
+
+                if (run_closed_loop(program, loop, group.lane_values.data(),
+                                    group.lane_defined.data(), lane_cmp_test,
+                                    UINT64_MAX) == 0) {
+                    group.pcs[lane]++; // Runs the loop
+                    continue;
+                }
+                for (size_t slot = 0; slot < group.regs.size(); slot++) {
+                    group.regs[slot].values[lane] =
+                        static_cast<std::uint32_t>(group.lane_values[slot]);
+                }
+                group.cmp_test[lane] =
+                    static_cast<std::uint32_t>(lane_cmp_test);
+                group.pcs[lane] = loop.exit;
+            }
+            together = false;
+            continue;
+        }
+
+        case OpCode::END:
+        case OpCode::HALT:
+            for (unsigned lane = 0; lane < lane_count; lane++) {
+                if ((lanes >> lane) & 1) {
+                    group.finish(lane, op.code == OpCode::END);
+                }
+            }
+            together = false;
+            continue;
+
+        case OpCode::INVALID_INTEGER:
+            group.escape_all(lanes);
+            continue;
+
+        // Superinstructions. Where they don't jump, they skip the code
+        // they fuse.
+
+#define FUSED_CMP_JUMP(jump, condition)                                        \
+    case OpCode::CMP_##jump:                                                   \
+        if (group.fails(op, lanes, CHECK_A | CHECK_B)) {                       \
+            continue;                                                          \
+        }                                                                      \
+        group.cmp_test = at ? OPERAND(op.a_kind, op.a) -                       \
+                                  OPERAND(op.b_kind, op.b)                     \
+                            : group.cmp_test;                                  \
+        BRANCH(Mask(group.cmp_test) condition 0, 2);                           \
+        continue;
+
+#define FUSED_STEP_CMP_JUMP(step, delta, jump, condition)                      \
+    case OpCode::step##_CMP_##jump: {                                          \
+        if (group.fails(op, lanes, CHECK_A | CHECK_B)) {                       \
+            continue;                                                          \
+        }                                                                      \
+        Lanes &a = group.regs[op.a].values;                                    \
+        a += Lanes(at & (delta));                                              \
+        group.cmp_test = at ? a - OPERAND(op.b_kind, op.b) : group.cmp_test;   \
+        BRANCH(Mask(group.cmp_test) condition 0, 3);                           \
+        continue;                                                              \
+    }
+
+            FUSED_CMP_JUMP(JNE, !=)
+            FUSED_CMP_JUMP(JE, ==)
+            FUSED_CMP_JUMP(JGE, >=)
+            FUSED_CMP_JUMP(JG, >)
+            FUSED_CMP_JUMP(JLE, <=)
+            FUSED_CMP_JUMP(JL, <)
+
+            FUSED_STEP_CMP_JUMP(INC, 1, JNE, !=)
+            FUSED_STEP_CMP_JUMP(INC, 1, JE, ==)
+            FUSED_STEP_CMP_JUMP(INC, 1, JGE, >=)
+            FUSED_STEP_CMP_JUMP(INC, 1, JG, >)
+            FUSED_STEP_CMP_JUMP(INC, 1, JLE, <=)
+            FUSED_STEP_CMP_JUMP(INC, 1, JL, <)
+
+            FUSED_STEP_CMP_JUMP(DEC, -1, JNE, !=)
+            FUSED_STEP_CMP_JUMP(DEC, -1, JE, ==)
+            FUSED_STEP_CMP_JUMP(DEC, -1, JGE, >=)
+            FUSED_STEP_CMP_JUMP(DEC, -1, JG, >)
+            FUSED_STEP_CMP_JUMP(DEC, -1, JLE, <=)
+            FUSED_STEP_CMP_JUMP(DEC, -1, JL, <)
+
+#undef FUSED_CMP_JUMP
+#undef FUSED_STEP_CMP_JUMP
+#undef BRANCH
+        }
+
+        // On to the next instruction, but for lanes that escaped on the way
+        group.pcs = at & (group.pcs == pc) ? Lanes{} + (pc + 1) : group.pcs;
+        pc++;
+    }
+}
+
+#undef OPERAND
+
+} // namespace
+
+auto run_lanes(
+    const Program &program,
+    const std::vector<std::vector<std::pair<std::string, int>>> &seeds,
+    ThreadPool &pool) -> std::vector<BatchResult> {
+    std::vector<BatchResult> results(seeds.size());
+
+    for (size_t first = 0; first < seeds.size(); first += lane_count) {
+        pool.submit([&, first] {
+            Group group(program, seeds.data() + first, results.data() + first,
+                        std::min(lane_count, seeds.size() - first));
+            run_group(group);
+        });
+    }
+    pool.wait();
+
+    return results;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "BatchExecutor.h"
+#include "Program.h"
+#include "ThreadPool.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// Seedings run side by side by run_lanes(), one per 32-bit lane of an AVX2
+// register
+constexpr size_t lane_count = 8;
+
+// Runs program once per seeding, lane_count seedings at a time. Every
+// register holds a lane per seeding, and each instruction runs at once for
+// all the lanes at its pc, on AVX2 where the CPU has it. Lanes branching
+// apart wait at the lowest pc for the others, so they run together again
+// where their paths join. A lane that fails, or runs alone for long,
+// finishes on a Machine of its own.
+// Results are in the order of the seedings, the same as run_batch() gives
+// for jobs of program with those seeds.
+auto run_lanes(
+    const Program &program,
+    const std::vector<std::vector<std::pair<std::string, int>>> &seeds,
+    ThreadPool &pool) -> std::vector<BatchResult>;
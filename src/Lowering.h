@@ -0,0 +1,129 @@
+#pragma once
+
+#include "Compiler.h"
+#include "Parser.h"
+#include "Program.h"
+
+#include <charconv>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// What lower_instruction() made of an instruction
+enum class Lowered {
+    LABEL, // Defines the label its first operand names, emits nothing
+    JUMP,  // op jumps or calls to the label its first operand names
+    OP     // op is complete
+};
+
+// Lowers a parsed instruction into op, the way compile() and
+// CompileSession both do it. Register names get their slot from
+// reg_slot(name). The arguments of 'msg' are appended to msg_args, op.target
+// being the first, and their strings to strings, which STR arguments are
+// offsets into. A jump's target is left to the caller to link.
+// An instruction with a number no int holds becomes INVALID_INTEGER, so
+// the program only fails if it runs. It first reads the registers the
+// instruction read before the number, appended to msg_args as 'msg' does:
+// for 'cmp' its first operand, for 'msg' the arguments before it. The
+// others read their second operand first, so they read none.
+template <typename RegSlot>
+auto lower_instruction(const Instruction &instruction,
+                       const unsigned int &lineno, RegSlot &&reg_slot, Op &op,
+                       std::vector<MsgArg> &msg_args, std::string &strings)
+    -> Lowered {
+    const auto &paramemters = instruction.paramemters;
+
+    if (instruction.ins_type == InstructionType::LABEL) {
+        return Lowered::LABEL;
+    }
+
+    // Immediates are decoded once here, never at run time. Returns false
+    // for a number no int holds.
+    const auto lower = [&](const Parameter &paramemter, OperandKind &kind,
+                           std::int32_t &value) {
+        const auto tok_data = paramemter.token_data;
+
+        if (paramemter.token_type == TokenType::NUMBER) {
+            kind = OperandKind::IMM;
+            return std::from_chars(tok_data.data(),
+                                   tok_data.data() + tok_data.size(), value)
+                       .ec == std::errc();
+        }
+
+        kind = OperandKind::REG;
+        value = reg_slot(tok_data);
+        return true;
+    };
+
+    op = Op{to_opcode(instruction.ins_type)};
+    op.line = lineno;
+
+    // The registers read before the number are msg_args from first on
+    const auto invalid = [&](const size_t &first) {
+        op = Op{OpCode::INVALID_INTEGER};
+        op.line = lineno;
+        op.a = static_cast<std::int32_t>(msg_args.size() - first);
+        op.target = static_cast<std::uint32_t>(first);
+    };
+
+    switch (op.code) {
+    case OpCode::JMP:
+    case OpCode::JNE:
+    case OpCode::JE:
+    case OpCode::JGE:
+    case OpCode::JG:
+    case OpCode::JLE:
+    case OpCode::JL:
+    case OpCode::CALL:
+        return Lowered::JUMP;
+
+    case OpCode::MSG: {
+        op.a = static_cast<std::int32_t>(paramemters.size());
+        op.target = static_cast<std::uint32_t>(msg_args.size());
+        const size_t strings_size = strings.size();
+
+        for (const auto &paramemter : paramemters) {
+            MsgArg arg{OperandKind::STR};
+            if (paramemter.token_type == TokenType::STRING) {
+                const auto &str = paramemter.token_data;
+                arg.value = static_cast<std::int32_t>(strings.size());
+                arg.size = static_cast<std::uint32_t>(str.size());
+                strings += str;
+            } else if (!lower(paramemter, arg.kind, arg.value)) {
+                // Keeps the registers before the number
+                size_t kept = op.target;
+                for (size_t i = op.target; i < msg_args.size(); i++) {
+                    if (msg_args[i].kind == OperandKind::REG) {
+                        msg_args[kept++] = msg_args[i];
+                    }
+                }
+                msg_args.resize(kept);
+                strings.resize(strings_size);
+                invalid(op.target);
+                break;
+            }
+            msg_args.push_back(arg);
+        }
+        break;
+    }
+
+    default: {
+        const bool a_valid =
+            paramemters.empty() || lower(paramemters[0], op.a_kind, op.a);
+        if (a_valid && (paramemters.size() < 2 ||
+                        lower(paramemters[1], op.b_kind, op.b))) {
+            break;
+        }
+
+        const size_t first = msg_args.size();
+        if (a_valid && op.code == OpCode::CMP &&
+            op.a_kind == OperandKind::REG) {
+            msg_args.push_back(MsgArg{OperandKind::REG, op.a});
+        }
+        invalid(first);
+        break;
+    }
+    }
+
+    return Lowered::OP;
+}
@@ -0,0 +1,379 @@
+#include "Machine.h"
+#include "Errors.h"
+#include "Optimizer.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <memory>
+#include <stack>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__GNUC__)
+#define HAS_COMPUTED_GOTO 1
+#else
+#define HAS_COMPUTED_GOTO 0
+#endif
+
+auto RegisterFile::get(const std::int32_t &slot, const std::uint32_t &lineno)
+    -> int & {
+    if (defined[slot]) {
+        return values[slot];
+    }
+
+    PARSE_ERR(lineno,
+              "Unknown register " + program.reg_names[slot] + " accessed.");
+}
+
+Machine::Machine(const Program &program) noexcept
+    : prog(program), regs(program), memo(program) {}
+
+auto Machine::set_register(const std::string_view &name, const int &value)
+    -> bool {
+    const auto slot = prog.register_slot(name);
+    if (slot < 0) {
+        return false;
+    }
+
+    regs.values[slot] = value;
+    regs.defined[slot] = true;
+    return true;
+}
+
+auto Machine::get_register(const std::string_view &name) const
+    -> std::optional<int> {
+    if (const auto slot = prog.register_slot(name);
+        slot >= 0 && regs.defined[slot]) {
+        return regs.values[slot];
+    }
+
+    return std::nullopt;
+}
+
+auto Machine::reset() -> void {
+    std::fill(regs.values.begin(), regs.values.end(), 0);
+    std::fill(regs.defined.begin(), regs.defined.end(), 0);
+    collected.clear();
+    ended = false;
+    is_suspended = false;
+}
+
+auto Machine::run(DispatchEngine engine) -> bool {
+    stack = {};
+    collected.clear();
+    resume_pc = 0;
+    resume_cmp_test = 0;
+    is_suspended = false;
+    memo.abandon();
+
+    if (engine == DispatchEngine::JIT) {
+        if (native_code_supported()) {
+            if (!native) {
+                native = std::make_shared<const NativeCode>(prog);
+            }
+            ended = native->run(regs, *output_sink, message);
+            output_sink->flush();
+            return ended;
+        }
+        engine = DispatchEngine::THREADED;
+    }
+
+#if HAS_COMPUTED_GOTO
+    if (engine == DispatchEngine::THREADED) {
+        ended = prog.verified ? run_threaded<true>() : run_threaded<false>();
+    } else {
+        ended = prog.verified ? run_switch<true>() : run_switch<false>();
+    }
+#else
+    static_cast<void>(engine);
+    ended = prog.verified ? run_switch<true>() : run_switch<false>();
+#endif
+
+    output_sink->flush();
+    return ended;
+}
+
+auto Machine::run_for(const std::uint64_t &budget) -> RunStatus {
+    return run_slice(budget, SIZE_MAX);
+}
+
+auto Machine::run_to(const std::string_view &label,
+                     const std::uint64_t &budget) -> RunStatus {
+    const auto search = std::find_if(
+        prog.labels.begin(), prog.labels.end(),
+        [&](const Label &defined) { return defined.name == label; });
+    if (search == prog.labels.end()) {
+        throw std::out_of_range("Unknown label " + std::string(label));
+    }
+
+    return run_slice(budget, search->target);
+}
+
+auto Machine::run_slice(const std::uint64_t &budget, const size_t &stop)
+    -> RunStatus {
+    if (!is_suspended) {
+        stack = {};
+        collected.clear();
+        resume_pc = 0;
+        resume_cmp_test = 0;
+        steps = 0;
+    }
+
+    // An error ends the run, the next one starts over
+    is_suspended = false;
+    const auto limit = steps + std::min(budget, UINT64_MAX - steps);
+    ended = run_budgeted(limit, stop);
+    output_sink->flush();
+
+    if (is_suspended) {
+        return RunStatus::SUSPENDED;
+    }
+    return ended ? RunStatus::ENDED : RunStatus::HALTED;
+}
+
+auto Machine::snapshot() const -> std::shared_ptr<const Snapshot> {
+    if (!is_suspended) {
+        throw std::logic_error("No suspended run to snapshot");
+    }
+
+    auto frozen = std::make_shared<Snapshot>();
+    frozen->program = &prog;
+    frozen->pc = resume_pc;
+    frozen->cmp_test = resume_cmp_test;
+    frozen->executed = steps;
+    frozen->values = regs.values;
+    frozen->defined = regs.defined;
+    frozen->stack = stack;
+    frozen->output = std::make_shared<const std::string>(collected.text());
+    return frozen;
+}
+
+auto Machine::restore(const Snapshot &snapshot) -> void {
+    if (snapshot.program != &prog) {
+        throw std::invalid_argument("Snapshot of another program");
+    }
+
+    regs.values = snapshot.values;
+    regs.defined = snapshot.defined;
+    stack = snapshot.stack;
+    collected.share(snapshot.output);
+    resume_pc = snapshot.pc;
+    resume_cmp_test = snapshot.cmp_test;
+    steps = snapshot.executed;
+    ended = false;
+    is_suspended = true;
+}
+
+auto Machine::resume(DispatchEngine engine) -> bool {
+    if (!is_suspended) {
+        return run(engine);
+    }
+    is_suspended = false;
+    memo.abandon();
+
+#if HAS_COMPUTED_GOTO
+    if (engine == DispatchEngine::SWITCH) {
+        ended = prog.verified ? run_switch<true>() : run_switch<false>();
+    } else {
+        ended = prog.verified ? run_threaded<true>() : run_threaded<false>();
+    }
+#else
+    static_cast<void>(engine);
+    ended = prog.verified ? run_switch<true>() : run_switch<false>();
+#endif
+
+    output_sink->flush();
+    return ended;
+}
+
+auto Machine::run_profiled(Profile &profile) -> bool {
+#if ASMINTERP_PROFILER
+    stack = {};
+    collected.clear();
+    is_suspended = false;
+    profile.restart();
+
+    ended = run_profiled_switch(profile);
+
+    output_sink->flush();
+    return ended;
+#else
+    static_cast<void>(profile);
+    throw std::runtime_error("Built without the profiler");
+#endif
+}
+
+template <bool verified> auto Machine::run_switch() -> bool {
+    const Program &program = prog;
+    OutputSink &output = *output_sink;
+    int cmp_test = resume_cmp_test;
+
+    const Op *const code = program.code.data();
+    const Op *op = nullptr;
+    size_t pc = resume_pc;
+
+#define OP(name) case OpCode::name:
+#define NEXT() continue
+#define MEMOIZE_CALLS 1
+#define CHECKED(check) (!verified || (op->checks & (check)) != 0)
+
+    for (;;) {
+        op = &code[pc++];
+
+        switch (op->code) {
+#include "Interpreter.inc"
+        }
+    }
+
+#undef OP
+#undef NEXT
+}
+
+#if ASMINTERP_PROFILER
+// The switch engine with the profiling hooks, so the other engines don't
+// pay for them.
+auto Machine::run_profiled_switch(Profile &profile) -> bool {
+    const Program &program = prog;
+    OutputSink &output = *output_sink;
+    int cmp_test = 0;
+
+    const Op *const code = program.code.data();
+    const Op *op = nullptr;
+    size_t pc = 0;
+
+#define OP(name) case OpCode::name:
+#define NEXT() continue
+#define PROFILE_STEP(index) profile.step(index)
+#define PROFILE_BRANCH(index, taken) profile.branch(index, taken)
+#define PROFILE_CALL(target) profile.enter(target)
+#define PROFILE_RET() profile.leave()
+#define CLOSED_LOOP_LIMIT 0 // Loops run as written, for their profile
+#define CLOSED_LOOP_RAN(count)
+
+    for (;;) {
+        op = &code[pc++];
+        if (op->code != OpCode::HALT && op->code != OpCode::CLOSED_LOOP) {
+            profile.step(pc - 1);
+        }
+
+        switch (op->code) {
+#include "Interpreter.inc"
+        }
+    }
+
+#undef OP
+#undef NEXT
+}
+#else
+auto Machine::run_profiled_switch(Profile &profile) -> bool {
+    static_cast<void>(profile);
+    return false;
+}
+#endif
+
+// The switch engine counting instructions, which suspends once steps
+// reaches limit or pc reaches stop. Each instruction of a fused sequence
+// counts, as in the profiling engine, and so does each of a closed loop.
+auto Machine::run_budgeted(const std::uint64_t &limit, const size_t &stop)
+    -> bool {
+    const Program &program = prog;
+    OutputSink &output = *output_sink;
+    int cmp_test = resume_cmp_test;
+
+    const Op *const code = program.code.data();
+    const Op *op = nullptr;
+    size_t pc = resume_pc;
+    Op unfused_op{OpCode::END};
+
+#define OP(name) case OpCode::name:
+#define NEXT() continue
+#define PROFILE_STEP(index) steps++
+#define PROFILE_BRANCH(index, taken)
+#define PROFILE_CALL(target)
+#define PROFILE_RET()
+// A loop whose body holds stop runs iteration by iteration
+#define CLOSED_LOOP_LIMIT                                                      \
+    (stop - pc < program.loops[op->target].exit - pc ? 0 : limit - steps)
+#define CLOSED_LOOP_RAN(count) steps += (count)
+
+    for (;;) {
+        if (steps >= limit || pc == stop) {
+            resume_pc = pc;
+            resume_cmp_test = cmp_test;
+            is_suspended = true;
+            return false;
+        }
+
+        op = &code[pc++];
+        // So is a fused sequence stop is in the middle of. Its first
+        // instruction runs alone, the rest follow it in the code.
+        if (stop - pc < 2 && unfused(op->code) != op->code) {
+            unfused_op = *op;
+            unfused_op.code = unfused(op->code);
+            op = &unfused_op;
+        }
+        if (op->code != OpCode::HALT && op->code != OpCode::CLOSED_LOOP) {
+            steps++;
+        }
+
+        switch (op->code) {
+#include "Interpreter.inc"
+        }
+    }
+
+#undef OP
+#undef NEXT
+}
+
+#if HAS_COMPUTED_GOTO
+// Labels as values are a GNU extension
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+
+template <bool verified> auto Machine::run_threaded() -> bool {
+    const Program &program = prog;
+    OutputSink &output = *output_sink;
+    int cmp_test = resume_cmp_test;
+
+    const Op *const code = program.code.data();
+    const Op *op = nullptr;
+    size_t pc = resume_pc;
+
+    // Indexed by OpCode, must list every opcode in declaration order
+    static const void *const dispatch_table[] = {
+        &&L_MOV, &&L_INC, &&L_DEC, &&L_ADD, &&L_SUB, &&L_MUL, &&L_DIV,
+        &&L_JMP, &&L_CMP, &&L_JNE, &&L_JE,  &&L_JGE, &&L_JG,  &&L_JLE,
+        &&L_JL,  &&L_CALL, &&L_RET, &&L_MSG, &&L_END, &&L_HALT,
+        &&L_INVALID_INTEGER, &&L_CMP_JNE, &&L_CMP_JE, &&L_CMP_JGE,
+        &&L_CMP_JG, &&L_CMP_JLE, &&L_CMP_JL, &&L_INC_CMP_JNE, &&L_INC_CMP_JE,
+        &&L_INC_CMP_JGE, &&L_INC_CMP_JG, &&L_INC_CMP_JLE, &&L_INC_CMP_JL,
+        &&L_DEC_CMP_JNE, &&L_DEC_CMP_JE, &&L_DEC_CMP_JGE, &&L_DEC_CMP_JG,
+        &&L_DEC_CMP_JLE, &&L_DEC_CMP_JL, &&L_CLOSED_LOOP};
+    static_assert(sizeof(dispatch_table) / sizeof(dispatch_table[0]) ==
+                      static_cast<size_t>(OpCode::CLOSED_LOOP) + 1,
+                  "dispatch_table is missing an opcode");
+
+#define OP(name) L_##name:
+#define MEMOIZE_CALLS 1
+#define CHECKED(check) (!verified || (op->checks & (check)) != 0)
+#define NEXT()                                                                 \
+    do {                                                                       \
+        op = &code[pc++];                                                      \
+        goto *dispatch_table[static_cast<size_t>(op->code)];                   \
+    } while (false)
+
+    NEXT();
+#include "Interpreter.inc"
+
+#undef OP
+#undef NEXT
+}
+
+#pragma GCC diagnostic pop
+#else
+template <bool verified> auto Machine::run_threaded() -> bool {
+    return run_switch<verified>();
+}
+#endif
@@ -0,0 +1,209 @@
+#pragma once
+
+#include "CallMemo.h"
+#include "Jit.h"
+#include "OutputSink.h"
+#include "Profiler.h"
+#include "Program.h"
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stack>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class DispatchEngine {
+    SWITCH,  // Portable switch inside a loop
+    THREADED, // Computed goto, falls back to SWITCH where unsupported
+    JIT       // Native code, falls back to THREADED where unsupported
+};
+
+#if ASMINTERP_COMPUTED_GOTO
+constexpr DispatchEngine default_dispatch_engine = DispatchEngine::THREADED;
+#else
+constexpr DispatchEngine default_dispatch_engine = DispatchEngine::SWITCH;
+#endif
+
+// Where a budgeted run stopped, see Machine::run_for()
+enum class RunStatus {
+    ENDED,    // Reached 'end'
+    HALTED,   // Ran off its end, without 'end'
+    SUSPENDED // Spent its budget, the next run_for() continues it
+};
+
+struct RegisterFile {
+    const Program &program;
+    std::vector<int> values;
+    // Registers are defined by 'mov' or seeding. Bytes rather than bits, so
+    // native code can test and set them directly.
+    std::vector<std::uint8_t> defined;
+
+    explicit RegisterFile(const Program &program)
+        : program(program), values(program.reg_names.size(), 0),
+          defined(program.reg_names.size(), 0) {}
+
+    auto get(const std::int32_t &slot, const std::uint32_t &lineno) -> int &;
+
+    auto read(const OperandKind &kind, const std::int32_t &value,
+              const std::uint32_t &lineno) -> int {
+        if (kind == OperandKind::IMM) {
+            return value;
+        }
+
+        return get(value, lineno);
+    }
+
+    // Same as read(), for a register known to be defined
+    auto peek(const OperandKind &kind, const std::int32_t &value) const
+        -> int {
+        return kind == OperandKind::IMM ? value : values[value];
+    }
+};
+
+// A suspended run frozen in place, see Machine::snapshot(). It is never
+// modified once taken, so any number of Machines on any number of threads
+// can go on from one.
+struct Snapshot {
+    const Program *program = nullptr;
+    size_t pc = 0;
+    int cmp_test = 0;
+    std::uint64_t executed = 0;
+    std::vector<int> values;
+    std::vector<std::uint8_t> defined;
+    std::stack<size_t> stack;
+    std::shared_ptr<const std::string> output; // Collected up to pc
+};
+
+// Per-run state of a compiled program: registers, call stack and output.
+// The Program is only read, so any number of Machines on any number of
+// threads can share one. It must outlive the Machines using it.
+class Machine {
+  public:
+    explicit Machine(const Program &program) noexcept;
+
+    // Seeds a register before a run. Returns false if the program never
+    // uses a register of that name.
+    auto set_register(const std::string_view &name, const int &value) -> bool;
+
+    // Value of a register, nothing if it is unused or was never defined.
+    auto get_register(const std::string_view &name) const
+        -> std::optional<int>;
+
+    // Clears registers and collected output, ready for seeding a fresh run.
+    auto reset() -> void;
+
+    // Streams 'msg' output to sink, which must outlive the runs using it,
+    // instead of collecting it. nullptr goes back to collecting.
+    auto set_output(OutputSink *sink) noexcept -> void {
+        output_sink = sink != nullptr ? sink : &collected;
+    }
+
+    // Runs the program from its first instruction on the current registers.
+    // Returns true if it reached 'end', false if it ran off its end. Output
+    // already streamed to a sink stays there in either case.
+    auto run(DispatchEngine engine = default_dispatch_engine) -> bool;
+
+    // Runs at most budget more instructions of the current run, starting
+    // a fresh one like run() unless the last run_for() suspended. Between
+    // calls the run keeps its position, registers, call stack and output,
+    // so a program that never ends can be run in bounded slices. A fused
+    // instruction sequence always runs whole, which can overrun the
+    // budget by two instructions. Runs on the switch engine.
+    auto run_for(const std::uint64_t &budget) -> RunStatus;
+
+    // Like run_for(), but also suspends once the run reaches the
+    // instruction at label, before running it, even inside a fused
+    // sequence or a closed loop. A run already there suspends at once.
+    // Throws std::out_of_range for labels the program doesn't define.
+    auto run_to(const std::string_view &label,
+                const std::uint64_t &budget = UINT64_MAX) -> RunStatus;
+
+    // Freezes the suspended run, to fork runs from it with restore(). Its
+    // output is what was collected, nothing if it went to a sink. Throws
+    // std::logic_error without a suspended run.
+    auto snapshot() const -> std::shared_ptr<const Snapshot>;
+
+    // Makes the frozen run, of this Machine's program, the suspended run,
+    // to go on with run_for() or resume(). Registers and call stack are
+    // copied, the output is shared until the run writes more. Throws
+    // std::invalid_argument for snapshots of other programs.
+    auto restore(const Snapshot &snapshot) -> void;
+
+    // Runs the suspended run to its end, without a budget, on engine;
+    // JIT runs THREADED, as native code only starts from the top. Without
+    // a suspended run it is run(). Returns what run() returns.
+    auto resume(DispatchEngine engine = default_dispatch_engine) -> bool;
+
+    // Whether the last run_for() suspended, with a run to continue
+    auto suspended() const noexcept -> bool { return is_suspended; }
+
+    // Instructions the current or last run_for() run has executed
+    auto executed() const noexcept -> std::uint64_t { return steps; }
+
+    // Uses code for the JIT engine, which must have been made from this
+    // Machine's program, so Machines of one program can share it. Otherwise
+    // the first JIT run translates the program for this Machine alone.
+    auto set_native_code(std::shared_ptr<const NativeCode> code) noexcept
+        -> void {
+        native = std::move(code);
+    }
+
+    // Like run(), on a slower engine recording into profile, which must
+    // have been made for this Machine's program. Throws if the profiler
+    // was compiled out (ASMINTERP_PROFILER).
+    auto run_profiled(Profile &profile) -> bool;
+
+    // Calls of pure subroutines (OptimizerPasses::pure_calls) run() and
+    // resume() skipped with a recorded result, and the ones they ran and
+    // recorded. Recorded results stay from one run to the next. The other
+    // engines, the JIT, run_for() and run_profiled(), run every call.
+    auto memo_hits() const noexcept -> std::uint64_t { return memo.hits(); }
+    auto memo_misses() const noexcept -> std::uint64_t {
+        return memo.misses();
+    }
+
+    // Results the memo table holds at most, 0 to run every call. Forgets
+    // what it recorded.
+    auto set_memo_capacity(const size_t &entries) -> void {
+        memo.set_capacity(entries);
+    }
+
+    // Output collected by the last run, empty when streaming to a sink
+    auto output() const noexcept -> const std::string & {
+        return collected.text();
+    }
+
+    // What assembler_interpreter returns: the output, or "-1" without 'end'
+    auto result() const -> std::string { return ended ? output() : "-1"; }
+
+    auto program() const noexcept -> const Program & { return prog; }
+
+  private:
+    // Verified engines only make the checks Op::checks leaves
+    template <bool verified> auto run_switch() -> bool;
+    template <bool verified> auto run_threaded() -> bool;
+    auto run_profiled_switch(Profile &profile) -> bool;
+    auto run_slice(const std::uint64_t &budget, const size_t &stop)
+        -> RunStatus;
+    auto run_budgeted(const std::uint64_t &limit, const size_t &stop)
+        -> bool;
+
+    const Program &prog;
+    RegisterFile regs;
+    std::stack<size_t> stack; // Currently only for pushing return locations
+    StringSink collected;
+    OutputSink *output_sink = &collected;
+    std::string message; // Reused to format each 'msg'
+    std::shared_ptr<const NativeCode> native;
+    CallMemo memo;
+    bool ended = false;
+
+    // Where a suspended run continues, and where the unbudgeted engines
+    // start
+    size_t resume_pc = 0;
+    int resume_cmp_test = 0;
+    std::uint64_t steps = 0;
+    bool is_suspended = false;
+};
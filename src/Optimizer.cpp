@@ -0,0 +1,1287 @@
+#include "Optimizer.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Offset of a conditional jump from JNE in the CMP_J<cc> family, or -1
+static auto condition_index(const OpCode &code) -> int {
+    switch (code) {
+    case OpCode::JNE:
+        return 0;
+    case OpCode::JE:
+        return 1;
+    case OpCode::JGE:
+        return 2;
+    case OpCode::JG:
+        return 3;
+    case OpCode::JLE:
+        return 4;
+    case OpCode::JL:
+        return 5;
+    default:
+        return -1;
+    }
+}
+
+static auto fused(const OpCode &family, const int &condition) -> OpCode {
+    return static_cast<OpCode>(static_cast<int>(family) + condition);
+}
+
+auto fuse_superinstructions(Program &program) -> void {
+    auto &code = program.code;
+
+    // The last instruction is always HALT, so code[i + 1] is valid
+    for (size_t i = 0; i + 1 < code.size(); i++) {
+        Op &op = code[i];
+
+        if (op.code == OpCode::CMP) {
+            if (const int condition = condition_index(code[i + 1].code);
+                condition >= 0) {
+                op.code = fused(OpCode::CMP_JNE, condition);
+                op.target = code[i + 1].target;
+            }
+        } else if ((op.code == OpCode::INC || op.code == OpCode::DEC) &&
+                   i + 2 < code.size()) {
+            const Op &cmp = code[i + 1];
+            const int condition = condition_index(code[i + 2].code);
+
+            if (cmp.code == OpCode::CMP && cmp.a_kind == OperandKind::REG &&
+                cmp.a == op.a && condition >= 0) {
+                op.code = fused(op.code == OpCode::INC ? OpCode::INC_CMP_JNE
+                                                       : OpCode::DEC_CMP_JNE,
+                                condition);
+                op.b_kind = cmp.b_kind;
+                op.b = cmp.b;
+                op.target = code[i + 2].target;
+            }
+        }
+    }
+}
+
+auto unfused(const OpCode &code) -> OpCode {
+    if (code >= OpCode::CMP_JNE && code <= OpCode::CMP_JL) {
+        return OpCode::CMP;
+    }
+    if (code >= OpCode::INC_CMP_JNE && code <= OpCode::INC_CMP_JL) {
+        return OpCode::INC;
+    }
+    if (code >= OpCode::DEC_CMP_JNE && code <= OpCode::DEC_CMP_JL) {
+        return OpCode::DEC;
+    }
+    return code;
+}
+
+auto find_leaders(const Program &program) -> std::vector<bool> {
+    const auto &code = program.code;
+    std::vector<bool> leaders(code.size(), false);
+
+    for (size_t i = 0; i < code.size(); i++) {
+        switch (code[i].code) {
+        case OpCode::JMP:
+        case OpCode::JNE:
+        case OpCode::JE:
+        case OpCode::JGE:
+        case OpCode::JG:
+        case OpCode::JLE:
+        case OpCode::JL:
+            leaders[code[i].target] = true;
+            break;
+        case OpCode::CALL:
+            leaders[code[i].target] = true;
+            leaders[i + 1] = true; // Return address, HALT ends the code
+            break;
+        case OpCode::CLOSED_LOOP:
+            leaders[program.loops[code[i].target].exit] = true;
+            break;
+        default:
+            break;
+        }
+    }
+
+    return leaders;
+}
+
+// Control flow graph optimizer
+
+namespace {
+
+// Registers times instructions above which optimize() leaves a program as
+// it is, its analyses being linear in both
+constexpr size_t analysis_limit = size_t{1} << 26;
+
+// The engines' int arithmetic wraps around
+auto wrap(const std::int64_t &value) -> std::int32_t {
+    return static_cast<std::int32_t>(static_cast<std::uint32_t>(value));
+}
+
+auto is_conditional(const OpCode &code) -> bool {
+    return condition_index(code) >= 0;
+}
+
+auto jump_taken(const OpCode &code, const std::int32_t &cmp_test) -> bool {
+    switch (code) {
+    case OpCode::JNE:
+        return cmp_test != 0;
+    case OpCode::JE:
+        return cmp_test == 0;
+    case OpCode::JGE:
+        return cmp_test >= 0;
+    case OpCode::JG:
+        return cmp_test > 0;
+    case OpCode::JLE:
+        return cmp_test <= 0;
+    case OpCode::JL:
+        return cmp_test < 0;
+    default:
+        return true;
+    }
+}
+
+auto ends_block(const OpCode &code) -> bool {
+    switch (code) {
+    case OpCode::JMP:
+    case OpCode::CALL:
+    case OpCode::RET:
+    case OpCode::END:
+    case OpCode::HALT:
+    case OpCode::INVALID_INTEGER:
+        return true;
+    default:
+        return is_conditional(code);
+    }
+}
+
+struct Block {
+    std::uint32_t first;
+    std::uint32_t last; // One past its last instruction
+    std::vector<std::uint32_t> successors;
+};
+
+// 'ret' may return to any return address, so its successors are the blocks
+// after every 'call'
+auto build_cfg(const Program &program) -> std::vector<Block> {
+    const auto &code = program.code;
+    auto starts = find_leaders(program);
+    starts[0] = true;
+    for (size_t i = 0; i + 1 < code.size(); i++) {
+        if (ends_block(code[i].code)) {
+            starts[i + 1] = true;
+        }
+    }
+
+    std::vector<Block> blocks;
+    std::vector<std::uint32_t> block_at(code.size());
+    for (size_t i = 0; i < code.size(); i++) {
+        if (starts[i]) {
+            if (!blocks.empty()) {
+                blocks.back().last = static_cast<std::uint32_t>(i);
+            }
+            blocks.push_back({static_cast<std::uint32_t>(i), 0, {}});
+        }
+        block_at[i] = static_cast<std::uint32_t>(blocks.size() - 1);
+    }
+    blocks.back().last = static_cast<std::uint32_t>(code.size());
+
+    std::vector<std::uint32_t> return_blocks;
+    for (size_t i = 0; i + 1 < code.size(); i++) {
+        if (code[i].code == OpCode::CALL) {
+            return_blocks.push_back(block_at[i + 1]);
+        }
+    }
+
+    for (auto &block : blocks) {
+        const Op &op = code[block.last - 1];
+        auto &successors = block.successors;
+
+        switch (op.code) {
+        case OpCode::JMP:
+        case OpCode::CALL:
+            successors.push_back(block_at[op.target]);
+            break;
+        case OpCode::RET:
+            successors = return_blocks;
+            break;
+        case OpCode::END:
+        case OpCode::HALT:
+        case OpCode::INVALID_INTEGER:
+            break;
+        default:
+            if (is_conditional(op.code)) {
+                successors.push_back(block_at[op.target]);
+            }
+            successors.push_back(block_at[block.last]);
+            break;
+        }
+    }
+
+    return blocks;
+}
+
+// What holds on every path to a point of the program
+struct State {
+    struct Fact {
+        std::int32_t value = 0;
+        std::int32_t copy_of = -1; // Register it surely equals, or -1
+        bool defined = false;
+        bool known = false; // Surely holding value
+    };
+
+    std::vector<Fact> facts; // Indexed by register slot
+    size_t copies = 0;       // Facts with a copy_of
+    bool cmp_known = true;   // cmp_test starts at 0
+    std::int32_t cmp_value = 0;
+
+    explicit State(const size_t &registers) : facts(registers) {}
+
+    // Keeps what also holds in other, returns whether anything changed
+    auto meet(const State &other) -> bool {
+        bool changed = false;
+
+        for (size_t r = 0; r < facts.size(); r++) {
+            Fact &fact = facts[r];
+            const Fact &theirs = other.facts[r];
+
+            if (fact.defined && !theirs.defined) {
+                fact.defined = false;
+                changed = true;
+            }
+            if (fact.known &&
+                (!theirs.known || theirs.value != fact.value)) {
+                fact.known = false;
+                changed = true;
+            }
+            if (fact.copy_of >= 0 && theirs.copy_of != fact.copy_of) {
+                fact.copy_of = -1;
+                copies--;
+                changed = true;
+            }
+        }
+        if (cmp_known &&
+            (!other.cmp_known || other.cmp_value != cmp_value)) {
+            cmp_known = false;
+            changed = true;
+        }
+
+        return changed;
+    }
+
+    auto constant(const OperandKind &kind, const std::int32_t &operand,
+                  std::int32_t &result) const -> bool {
+        if (kind == OperandKind::IMM) {
+            result = operand;
+            return true;
+        }
+        if (kind == OperandKind::REG && facts[operand].known) {
+            result = facts[operand].value;
+            return true;
+        }
+        return false;
+    }
+
+    // A register read: past it, the register is defined, or the run failed
+    auto read(const OperandKind &kind, const std::int32_t &operand) -> void {
+        if (kind == OperandKind::REG) {
+            facts[operand].defined = true;
+        }
+    }
+
+    auto write(const std::int32_t &reg, const bool &is_known,
+               const std::int32_t &result, const std::int32_t &copy_of)
+        -> void {
+        // Copies of the register no longer hold
+        for (size_t r = 0; copies > 0 && r < facts.size(); r++) {
+            if (facts[r].copy_of == reg ||
+                (r == static_cast<size_t>(reg) && facts[r].copy_of >= 0)) {
+                facts[r].copy_of = -1;
+                copies--;
+            }
+        }
+
+        Fact &fact = facts[reg];
+        fact.defined = true;
+        fact.known = is_known;
+        fact.value = result;
+        if (copy_of >= 0 && copy_of != reg) {
+            fact.copy_of = copy_of;
+            copies++;
+        }
+    }
+
+    // Value an instruction writes, if it is known
+    auto result(const Op &op, std::int32_t &written) const -> bool;
+
+    auto step(const Op &op, const Program &program) -> void;
+};
+
+auto State::result(const Op &op, std::int32_t &written) const -> bool {
+    std::int32_t a = 0;
+    std::int32_t b = 0;
+
+    switch (op.code) {
+    case OpCode::MOV:
+        return constant(op.b_kind, op.b, written);
+    case OpCode::INC:
+    case OpCode::DEC:
+        if (!constant(op.a_kind, op.a, a)) {
+            return false;
+        }
+        written = wrap(std::int64_t{a} + (op.code == OpCode::INC ? 1 : -1));
+        return true;
+    case OpCode::ADD:
+    case OpCode::SUB:
+    case OpCode::MUL:
+    case OpCode::DIV:
+        if (!constant(op.a_kind, op.a, a) || !constant(op.b_kind, op.b, b)) {
+            return false;
+        }
+        if (op.code == OpCode::ADD) {
+            written = wrap(std::int64_t{a} + b);
+        } else if (op.code == OpCode::SUB) {
+            written = wrap(std::int64_t{a} - b);
+        } else if (op.code == OpCode::MUL) {
+            written = wrap(std::int64_t{a} * b);
+        } else if (b != 0 && !(a == INT32_MIN && b == -1)) {
+            written = a / b;
+        } else {
+            return false;
+        }
+        return true;
+    default:
+        return false;
+    }
+}
+
+auto State::step(const Op &op, const Program &program) -> void {
+    std::int32_t a = 0;
+    std::int32_t b = 0;
+
+    switch (op.code) {
+    case OpCode::MOV: {
+        read(op.b_kind, op.b);
+        std::int32_t source = -1;
+        if (op.b_kind == OperandKind::REG) {
+            source = facts[op.b].copy_of >= 0 ? facts[op.b].copy_of : op.b;
+        }
+        const bool is_known = result(op, b);
+        write(op.a, is_known, b, source);
+        break;
+    }
+    case OpCode::INC:
+    case OpCode::DEC:
+    case OpCode::ADD:
+    case OpCode::SUB:
+    case OpCode::MUL:
+    case OpCode::DIV: {
+        read(op.b_kind, op.b);
+        read(op.a_kind, op.a);
+        const bool is_known = result(op, a);
+        write(op.a, is_known, a, -1);
+        break;
+    }
+    case OpCode::CMP:
+        read(op.a_kind, op.a);
+        read(op.b_kind, op.b);
+        cmp_known = constant(op.a_kind, op.a, a) &&
+                    constant(op.b_kind, op.b, b);
+        cmp_value = wrap(std::int64_t{a} - b);
+        break;
+    case OpCode::MSG:
+    case OpCode::INVALID_INTEGER:
+        for (auto arg = program.msg_args.begin() + op.target,
+                  last = arg + op.a;
+             arg != last; arg++) {
+            read(arg->kind, arg->value);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+// The register an instruction writes, with cmp_slot for cmp_test, or -1
+auto written_slot(const Op &op, const std::int32_t &cmp_slot)
+    -> std::int32_t {
+    switch (op.code) {
+    case OpCode::MOV:
+    case OpCode::INC:
+    case OpCode::DEC:
+    case OpCode::ADD:
+    case OpCode::SUB:
+    case OpCode::MUL:
+    case OpCode::DIV:
+        return op.a;
+    case OpCode::CMP:
+        return cmp_slot;
+    default:
+        return -1;
+    }
+}
+
+// Whether an instruction does nothing but write written_slot(), once its
+// reads are known to be defined. Divisions could still fail or trap.
+auto only_writes(const Op &op) -> bool {
+    if (op.code == OpCode::DIV) {
+        return op.b_kind == OperandKind::IMM && op.b != 0 && op.b != -1;
+    }
+    return op.code != OpCode::MSG && written_slot(op, 0) >= 0;
+}
+
+struct Analysis {
+    std::vector<State> in; // At the start of every block
+    std::vector<bool> reached;
+};
+
+auto analyze(const Program &program, const std::vector<Block> &blocks)
+    -> Analysis {
+    const size_t registers = program.reg_names.size();
+    Analysis analysis{std::vector<State>(blocks.size(), State(registers)),
+                      std::vector<bool>(blocks.size(), false)};
+
+    std::vector<std::uint32_t> worklist{0};
+    std::vector<bool> queued(blocks.size(), false);
+    analysis.reached[0] = true;
+    queued[0] = true;
+
+    while (!worklist.empty()) {
+        const auto index = worklist.back();
+        worklist.pop_back();
+        queued[index] = false;
+
+        State state = analysis.in[index];
+        const Block &block = blocks[index];
+        for (auto i = block.first; i < block.last; i++) {
+            state.step(program.code[i], program);
+        }
+
+        for (const auto &successor : block.successors) {
+            bool changed = false;
+            if (!analysis.reached[successor]) {
+                analysis.reached[successor] = true;
+                analysis.in[successor] = state;
+                changed = true;
+            } else {
+                changed = analysis.in[successor].meet(state);
+            }
+            if (changed && !queued[successor]) {
+                queued[successor] = true;
+                worklist.push_back(successor);
+            }
+        }
+    }
+
+    return analysis;
+}
+
+// Drops the removed instructions, retargeting jumps, calls and labels at
+// the instruction that followed them. Returns whether any was removed.
+auto compact(Program &program, const std::vector<bool> &removed) -> bool {
+    auto &code = program.code;
+    std::vector<std::uint32_t> new_index(code.size());
+    std::uint32_t kept = 0;
+    for (size_t i = 0; i < code.size(); i++) {
+        new_index[i] = kept;
+        kept += removed[i] ? 0 : 1;
+    }
+    if (kept == code.size()) {
+        return false;
+    }
+
+    size_t next = 0;
+    for (size_t i = 0; i < code.size(); i++) {
+        if (removed[i]) {
+            continue;
+        }
+        Op op = code[i];
+        if (op.code == OpCode::JMP || op.code == OpCode::CALL ||
+            is_conditional(op.code)) {
+            op.target = new_index[op.target];
+        }
+        code[next++] = op;
+    }
+    code.resize(next);
+
+    for (auto &label : program.labels) {
+        label.target = new_index[label.target];
+    }
+
+    return true;
+}
+
+// Constant and copy propagation, with their folding, over the reached
+// blocks. Returns whether anything changed.
+auto propagate(Program &program, const std::vector<Block> &blocks,
+               const Analysis &analysis, const OptimizerPasses &passes,
+               std::vector<bool> &removed) -> bool {
+    bool changed = false;
+
+    // Source operands only, never a register an instruction writes
+    const auto substitute = [&](const State &state, OperandKind &kind,
+                                std::int32_t &operand) {
+        if (kind != OperandKind::REG) {
+            return;
+        }
+        const auto &fact = state.facts[operand];
+        if (passes.constant_propagation && fact.known) {
+            kind = OperandKind::IMM;
+            operand = fact.value;
+            changed = true;
+        } else if (passes.copy_propagation && fact.copy_of >= 0) {
+            operand = fact.copy_of;
+            changed = true;
+        }
+    };
+
+    for (size_t index = 0; index < blocks.size(); index++) {
+        if (!analysis.reached[index]) {
+            continue;
+        }
+
+        State state = analysis.in[index];
+        for (auto i = blocks[index].first; i < blocks[index].last; i++) {
+            Op &op = program.code[i];
+
+            switch (op.code) {
+            case OpCode::MOV:
+            case OpCode::ADD:
+            case OpCode::SUB:
+            case OpCode::MUL:
+            case OpCode::DIV:
+                substitute(state, op.b_kind, op.b);
+                break;
+            case OpCode::CMP:
+                substitute(state, op.a_kind, op.a);
+                substitute(state, op.b_kind, op.b);
+                break;
+            case OpCode::MSG:
+                for (auto arg = program.msg_args.begin() + op.target,
+                          last = arg + op.a;
+                     arg != last; arg++) {
+                    substitute(state, arg->kind, arg->value);
+                }
+                break;
+            default:
+                break;
+            }
+
+            if (passes.constant_propagation) {
+                if (is_conditional(op.code) && state.cmp_known) {
+                    if (jump_taken(op.code, state.cmp_value)) {
+                        op.code = OpCode::JMP;
+                    } else {
+                        removed[i] = true;
+                    }
+                    changed = true;
+                }
+
+                // Arithmetic on constants becomes 'mov' of the result. The
+                // operands are defined, so neither can fail.
+                const bool writes = op.code != OpCode::MOV &&
+                                    op.code != OpCode::CMP &&
+                                    written_slot(op, 0) >= 0;
+                std::int32_t folded = 0;
+                if (writes && state.result(op, folded)) {
+                    op.code = OpCode::MOV;
+                    op.b_kind = OperandKind::IMM;
+                    op.b = folded;
+                    changed = true;
+                } else if (writes && op.b_kind == OperandKind::IMM &&
+                           state.facts[op.a].defined &&
+                           (op.code == OpCode::MUL || op.code == OpCode::DIV
+                                ? op.b == 1
+                                : op.b == 0)) {
+                    // add a, 0 / sub a, 0 / mul a, 1 / div a, 1 on a
+                    // defined register
+                    removed[i] = true;
+                    changed = true;
+                }
+            }
+
+            if (!removed[i]) {
+                state.step(op, program);
+            }
+        }
+    }
+
+    return changed;
+}
+
+// Removes what no path from the first instruction reaches, except the
+// final HALT, and jumps to the next instruction
+auto remove_unreachable(const Program &program,
+                        const std::vector<Block> &blocks,
+                        const Analysis &analysis, std::vector<bool> &removed)
+    -> void {
+    for (size_t index = 0; index < blocks.size(); index++) {
+        if (!analysis.reached[index]) {
+            for (auto i = blocks[index].first; i < blocks[index].last; i++) {
+                removed[i] = i + 1 < program.code.size();
+            }
+        }
+    }
+
+    for (size_t i = 0; i + 1 < program.code.size(); i++) {
+        if (program.code[i].code == OpCode::JMP &&
+            program.code[i].target == i + 1) {
+            removed[i] = true;
+        }
+    }
+}
+
+// Calls use(slot) for every register an instruction reads, cmp_slot
+// standing for cmp_test
+template <typename Use>
+auto for_each_use(const Op &op, const Program &program,
+                  const std::int32_t &cmp_slot, Use use) -> void {
+    const auto operand = [&](const OperandKind &kind,
+                             const std::int32_t &value) {
+        if (kind == OperandKind::REG) {
+            use(value);
+        }
+    };
+
+    switch (op.code) {
+    case OpCode::MOV:
+        operand(op.b_kind, op.b);
+        break;
+    case OpCode::INC:
+    case OpCode::DEC:
+    case OpCode::ADD:
+    case OpCode::SUB:
+    case OpCode::MUL:
+    case OpCode::DIV:
+    case OpCode::CMP:
+        operand(op.a_kind, op.a);
+        operand(op.b_kind, op.b);
+        break;
+    case OpCode::MSG:
+    case OpCode::INVALID_INTEGER:
+        for (auto arg = program.msg_args.begin() + op.target,
+                  last = arg + op.a;
+             arg != last; arg++) {
+            operand(arg->kind, arg->value);
+        }
+        break;
+    default:
+        if (is_conditional(op.code)) {
+            use(cmp_slot);
+        }
+        break;
+    }
+}
+
+// Liveness of the registers and cmp_test, then removal of the writes
+// nothing reads whose operands are surely defined. Nothing is live at
+// 'end' or past the end of the program.
+auto remove_dead_stores(const Program &program,
+                        const std::vector<Block> &blocks,
+                        const Analysis &analysis, std::vector<bool> &removed)
+    -> void {
+    const auto cmp_slot = static_cast<std::int32_t>(program.reg_names.size());
+    const size_t slots = program.reg_names.size() + 1;
+
+    std::vector<std::vector<std::uint32_t>> predecessors(blocks.size());
+    for (size_t index = 0; index < blocks.size(); index++) {
+        for (const auto &successor : blocks[index].successors) {
+            predecessors[successor].push_back(
+                static_cast<std::uint32_t>(index));
+        }
+    }
+
+    const auto live_out = [&](const std::vector<std::vector<std::uint8_t>>
+                                  &live_in,
+                              const size_t &index) {
+        std::vector<std::uint8_t> live(slots, 0);
+        for (const auto &successor : blocks[index].successors) {
+            for (size_t slot = 0; slot < slots; slot++) {
+                live[slot] |= live_in[successor][slot];
+            }
+        }
+        return live;
+    };
+
+    const auto transfer = [&](const Op &op, std::vector<std::uint8_t> &live) {
+        if (const auto slot = written_slot(op, cmp_slot); slot >= 0) {
+            live[slot] = 0;
+        }
+        for_each_use(op, program, cmp_slot,
+                     [&](const std::int32_t &slot) { live[slot] = 1; });
+    };
+
+    std::vector<std::vector<std::uint8_t>> live_in(
+        blocks.size(), std::vector<std::uint8_t>(slots, 0));
+    std::vector<std::uint32_t> worklist;
+    std::vector<bool> queued(blocks.size(), true);
+    for (size_t index = 0; index < blocks.size(); index++) {
+        worklist.push_back(static_cast<std::uint32_t>(index));
+    }
+
+    while (!worklist.empty()) {
+        const auto index = worklist.back();
+        worklist.pop_back();
+        queued[index] = false;
+
+        auto live = live_out(live_in, index);
+        for (auto i = blocks[index].last; i-- > blocks[index].first;) {
+            transfer(program.code[i], live);
+        }
+
+        if (live != live_in[index]) {
+            live_in[index] = std::move(live);
+            for (const auto &predecessor : predecessors[index]) {
+                if (!queued[predecessor]) {
+                    queued[predecessor] = true;
+                    worklist.push_back(predecessor);
+                }
+            }
+        }
+    }
+
+    std::vector<bool> reads_defined;
+    for (size_t index = 0; index < blocks.size(); index++) {
+        if (!analysis.reached[index]) {
+            continue;
+        }
+        const Block &block = blocks[index];
+
+        // Whether every register each instruction reads is surely defined
+        State state = analysis.in[index];
+        reads_defined.assign(block.last - block.first, false);
+        for (auto i = block.first; i < block.last; i++) {
+            bool defined = true;
+            for_each_use(program.code[i], program, cmp_slot,
+                         [&](const std::int32_t &slot) {
+                             defined = defined && (slot == cmp_slot ||
+                                                   state.facts[slot].defined);
+                         });
+            reads_defined[i - block.first] = defined;
+            state.step(program.code[i], program);
+        }
+
+        auto live = live_out(live_in, index);
+        for (auto i = block.last; i-- > block.first;) {
+            const Op &op = program.code[i];
+            const auto slot = written_slot(op, cmp_slot);
+
+            if (only_writes(op) && !live[slot] &&
+                reads_defined[i - block.first]) {
+                removed[i] = true;
+            } else {
+                transfer(op, live);
+            }
+        }
+    }
+}
+
+// Closed form loops
+
+// Summary of the loop the conditional jump at index closes, if it is one
+// a ClosedLoop describes. Updates go to program.loop_updates.
+auto close_loop(Program &program, const size_t &index, ClosedLoop &loop)
+    -> bool {
+    const auto &code = program.code;
+    const Op &jump = code[index];
+    const size_t head = jump.target;
+    if (head + 2 > index) {
+        return false;
+    }
+
+    const Op &cmp = code[index - 1];
+    if (cmp.code != OpCode::CMP || cmp.a_kind != OperandKind::REG) {
+        return false;
+    }
+
+    const auto writes = [&](const std::int32_t &slot) {
+        for (auto i = head; i + 1 < index; i++) {
+            if (code[i].a == slot) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // Reads of the counter see what each update before added to it
+    std::int64_t step = 0;
+    std::vector<std::int32_t> offsets;
+    for (auto i = head; i + 1 < index; i++) {
+        const Op &op = code[i];
+        switch (op.code) {
+        case OpCode::INC:
+        case OpCode::DEC:
+        case OpCode::ADD:
+        case OpCode::SUB:
+            break;
+        default:
+            return false;
+        }
+        if (op.b_kind == OperandKind::REG && op.b != cmp.a && writes(op.b)) {
+            return false;
+        }
+        offsets.push_back(wrap(step));
+        if (op.a == cmp.a) {
+            if (op.b_kind == OperandKind::REG) {
+                return false;
+            }
+            const std::int64_t delta =
+                op.code == OpCode::INC ? 1
+                : op.code == OpCode::DEC ? -1
+                                         : op.b;
+            step += op.code == OpCode::SUB ? -delta : delta;
+        }
+    }
+    step = wrap(step);
+    if ((step != 1 && step != -1) ||
+        (cmp.b_kind == OperandKind::REG && writes(cmp.b))) {
+        return false;
+    }
+
+    loop.counter = cmp.a;
+    loop.step = static_cast<std::int32_t>(step);
+    loop.bound_kind = cmp.b_kind;
+    loop.bound = cmp.b;
+    loop.condition = jump.code;
+    loop.first_update = static_cast<std::uint32_t>(program.loop_updates.size());
+    loop.update_count = static_cast<std::uint32_t>(index - 1 - head);
+    loop.exit = static_cast<std::uint32_t>(index + 1);
+
+    for (auto i = head; i + 1 < index; i++) {
+        const Op &op = code[i];
+        LoopUpdate update{OpCode::ADD, OperandKind::IMM, op.a, 1};
+        if (op.code == OpCode::DEC) {
+            update.code = OpCode::SUB;
+        } else if (op.code == OpCode::ADD || op.code == OpCode::SUB) {
+            update.code = op.code;
+            update.kind = op.b_kind;
+            update.value = op.b;
+            update.offset = offsets[i - head];
+        }
+        program.loop_updates.push_back(update);
+    }
+
+    return true;
+}
+
+// Puts a CLOSED_LOOP before the head of every loop a ClosedLoop can
+// describe. Control entering the head from elsewhere goes through it, the
+// jump closing the loop still goes to the head.
+auto close_loops(Program &program) -> void {
+    auto &code = program.code;
+    std::vector<std::uint32_t> loop_at(code.size(), UINT32_MAX);
+
+    for (size_t i = 0; i < code.size(); i++) {
+        ClosedLoop loop;
+        if (is_conditional(code[i].code) && code[i].target < i &&
+            loop_at[code[i].target] == UINT32_MAX &&
+            close_loop(program, i, loop)) {
+            loop_at[code[i].target] =
+                static_cast<std::uint32_t>(program.loops.size());
+            program.loops.push_back(loop);
+        }
+    }
+    if (program.loops.empty()) {
+        return;
+    }
+
+    // Where control entering each instruction goes now
+    std::vector<std::uint32_t> entry(code.size());
+    std::uint32_t inserted = 0;
+    for (size_t i = 0; i < code.size(); i++) {
+        entry[i] = static_cast<std::uint32_t>(i) + inserted;
+        inserted += loop_at[i] != UINT32_MAX ? 1 : 0;
+    }
+
+    std::vector<Op> closed;
+    closed.reserve(code.size() + inserted);
+    for (size_t i = 0; i < code.size(); i++) {
+        if (loop_at[i] != UINT32_MAX) {
+            Op op{OpCode::CLOSED_LOOP};
+            op.target = loop_at[i];
+            op.line = code[i].line;
+            closed.push_back(op);
+        }
+
+        Op op = code[i];
+        if (op.code == OpCode::JMP || op.code == OpCode::CALL ||
+            is_conditional(op.code)) {
+            op.target = entry[op.target];
+        }
+        closed.push_back(op);
+    }
+
+    for (auto &loop : program.loops) {
+        const Op &jump = code[loop.exit - 1];
+        closed[entry[loop.exit - 1]].target = entry[jump.target] + 1;
+        loop.exit = entry[loop.exit];
+    }
+    for (auto &label : program.labels) {
+        label.target = entry[label.target];
+    }
+
+    code = std::move(closed);
+}
+
+// Pure subroutines
+
+// What a subroutine, and everything it calls, can do
+struct Routine {
+    bool pure = true;
+    bool returns = false;
+    std::vector<bool> uses; // By register slot, read or written
+    std::vector<bool> writes;
+    bool reads_cmp_test = false;
+    bool writes_cmp_test = false;
+};
+
+auto operator==(const Routine &a, const Routine &b) -> bool {
+    return a.pure == b.pure && a.returns == b.returns && a.uses == b.uses &&
+           a.writes == b.writes && a.reads_cmp_test == b.reads_cmp_test &&
+           a.writes_cmp_test == b.writes_cmp_test;
+}
+
+// Summary of the subroutine at entry, from the current summaries of those
+// it calls. A call goes on after it, as the callee returns there.
+auto summarize(const Program &program, const std::uint32_t &entry,
+               const std::vector<std::uint32_t> &routine_at,
+               const std::vector<Routine> &routines) -> Routine {
+    const auto &code = program.code;
+    Routine routine;
+    routine.uses.assign(program.reg_names.size(), false);
+    routine.writes.assign(program.reg_names.size(), false);
+
+    // Whether every path to an instruction sets cmp_test first
+    enum : std::uint8_t { UNSEEN, SET, UNSET };
+    std::vector<std::uint8_t> cmp_test(code.size(), UNSEEN);
+    std::vector<std::uint32_t> worklist{entry};
+    cmp_test[entry] = UNSET;
+
+    const auto reach = [&](const std::uint32_t &index, const bool &set) {
+        const auto state = set ? SET : UNSET;
+        if (cmp_test[index] == UNSEEN ||
+            (cmp_test[index] == SET && state == UNSET)) {
+            cmp_test[index] = state;
+            worklist.push_back(index);
+        }
+    };
+
+    while (!worklist.empty()) {
+        const auto index = worklist.back();
+        worklist.pop_back();
+        const Op &op = code[index];
+        const bool set = cmp_test[index] == SET;
+
+        switch (op.code) {
+        case OpCode::MSG:
+        case OpCode::END:
+        case OpCode::HALT:
+        case OpCode::INVALID_INTEGER:
+            routine.pure = false;
+            return routine;
+        case OpCode::RET:
+            break;
+        case OpCode::JMP:
+            reach(op.target, set);
+            break;
+        case OpCode::CALL: {
+            const Routine &callee = routines[routine_at[op.target]];
+            if (!callee.pure) {
+                routine.pure = false;
+                return routine;
+            }
+            reach(index + 1, set);
+            break;
+        }
+        case OpCode::CLOSED_LOOP:
+            reach(index + 1, true);
+            reach(program.loops[op.target].exit, true);
+            break;
+        case OpCode::CMP:
+            reach(index + 1, true);
+            break;
+        default:
+            if (is_conditional(op.code)) {
+                reach(op.target, set);
+            }
+            reach(index + 1, set);
+            break;
+        }
+    }
+
+    for (size_t index = 0; index < code.size(); index++) {
+        if (cmp_test[index] == UNSEEN) {
+            continue;
+        }
+        const Op &op = code[index];
+        const bool set = cmp_test[index] == SET;
+
+        if (op.a_kind == OperandKind::REG) {
+            routine.uses[op.a] = true;
+        }
+        if (op.b_kind == OperandKind::REG) {
+            routine.uses[op.b] = true;
+        }
+
+        switch (op.code) {
+        case OpCode::MOV:
+        case OpCode::INC:
+        case OpCode::DEC:
+        case OpCode::ADD:
+        case OpCode::SUB:
+        case OpCode::MUL:
+        case OpCode::DIV:
+            routine.writes[op.a] = true;
+            break;
+        case OpCode::CMP:
+        case OpCode::CLOSED_LOOP:
+            routine.writes_cmp_test = true;
+            break;
+        case OpCode::RET:
+            routine.returns = true;
+            break;
+        case OpCode::CALL: {
+            const Routine &callee = routines[routine_at[op.target]];
+            for (size_t slot = 0; slot < callee.uses.size(); slot++) {
+                routine.uses[slot] = routine.uses[slot] || callee.uses[slot];
+                routine.writes[slot] =
+                    routine.writes[slot] || callee.writes[slot];
+            }
+            routine.reads_cmp_test |= callee.reads_cmp_test && !set;
+            routine.writes_cmp_test |= callee.writes_cmp_test;
+            break;
+        }
+        default:
+            routine.reads_cmp_test |= is_conditional(op.code) && !set;
+            break;
+        }
+    }
+
+    // Returning without setting cmp_test hands back the caller's
+    for (size_t index = 0; index < code.size(); index++) {
+        if (code[index].code == OpCode::RET && cmp_test[index] == UNSET &&
+            routine.writes_cmp_test) {
+            routine.reads_cmp_test = true;
+        }
+    }
+
+    return routine;
+}
+
+// Marks the calls of every pure subroutine, see PureRoutine. Subroutines
+// start out assumed pure and lose it for good, so recursion settles.
+auto mark_pure_calls(Program &program) -> void {
+    auto &code = program.code;
+    std::vector<std::uint32_t> entries;
+    std::vector<std::uint32_t> routine_at(code.size(), UINT32_MAX);
+
+    for (const auto &op : code) {
+        if (op.code == OpCode::CALL && routine_at[op.target] == UINT32_MAX) {
+            routine_at[op.target] = static_cast<std::uint32_t>(entries.size());
+            entries.push_back(op.target);
+        }
+    }
+    if (entries.empty()) {
+        return;
+    }
+
+    std::vector<Routine> routines(entries.size());
+    for (auto &routine : routines) {
+        routine.uses.assign(program.reg_names.size(), false);
+        routine.writes.assign(program.reg_names.size(), false);
+    }
+
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (size_t i = 0; i < entries.size(); i++) {
+            auto summary = summarize(program, entries[i], routine_at, routines);
+            if (!(summary == routines[i])) {
+                routines[i] = std::move(summary);
+                changed = true;
+            }
+        }
+    }
+
+    std::vector<std::uint32_t> pure_index(entries.size(), UINT32_MAX);
+    for (size_t i = 0; i < entries.size(); i++) {
+        const Routine &routine = routines[i];
+        if (!routine.pure || !routine.returns) {
+            continue;
+        }
+
+        PureRoutine pure;
+        pure.first_slot = static_cast<std::uint32_t>(program.pure_slots.size());
+        for (size_t slot = 0; slot < routine.uses.size(); slot++) {
+            if (routine.uses[slot]) {
+                if (routine.writes[slot]) {
+                    pure.written |= 1U << pure.slot_count;
+                }
+                program.pure_slots.push_back(static_cast<std::int32_t>(slot));
+                pure.slot_count++;
+                if (pure.slot_count > max_pure_slots) {
+                    break;
+                }
+            }
+        }
+        if (pure.slot_count > max_pure_slots) {
+            program.pure_slots.resize(pure.first_slot);
+            continue;
+        }
+        pure.reads_cmp_test = routine.reads_cmp_test;
+        pure.writes_cmp_test = routine.writes_cmp_test;
+
+        pure_index[i] =
+            static_cast<std::uint32_t>(program.pure_routines.size());
+        program.pure_routines.push_back(pure);
+    }
+
+    for (auto &op : code) {
+        if (op.code == OpCode::CALL &&
+            pure_index[routine_at[op.target]] != UINT32_MAX) {
+            op.a_kind = OperandKind::IMM;
+            op.a = static_cast<std::int32_t>(
+                pure_index[routine_at[op.target]]);
+        }
+    }
+}
+
+} // namespace
+
+auto loop_exit_range(const OpCode &condition)
+    -> std::pair<std::uint32_t, std::uint32_t> {
+    switch (condition) {
+    case OpCode::JE:
+        return {1, UINT32_MAX};
+    case OpCode::JGE:
+        return {0x80000000, UINT32_MAX};
+    case OpCode::JG:
+        return {0x80000000, 0};
+    case OpCode::JLE:
+        return {1, 0x7fffffff};
+    case OpCode::JL:
+        return {0, 0x7fffffff};
+    default: // JNE
+        return {0, 0};
+    }
+}
+
+auto run_closed_loop(const Program &program, const ClosedLoop &loop,
+                     int *values, const std::uint8_t *defined, int &cmp_test,
+                     const std::uint64_t &max_instructions) -> std::uint64_t {
+    const auto first = program.loop_updates.begin() + loop.first_update;
+    const auto last = first + loop.update_count;
+
+    // Every register the loop reads must be defined, for it not to fail
+    if (!defined[loop.counter] ||
+        (loop.bound_kind == OperandKind::REG && !defined[loop.bound])) {
+        return 0;
+    }
+    for (auto update = first; update != last; update++) {
+        if (!defined[update->slot] ||
+            (update->kind == OperandKind::REG && !defined[update->value])) {
+            return 0;
+        }
+    }
+
+    // cmp_test after the first iteration, it moves by step on every other
+    const std::uint32_t bound = static_cast<std::uint32_t>(
+        loop.bound_kind == OperandKind::REG ? values[loop.bound]
+                                            : loop.bound);
+    const std::uint32_t entered =
+        static_cast<std::uint32_t>(values[loop.counter]) +
+        static_cast<std::uint32_t>(loop.step) - bound;
+
+    // Moving by step, it ends the loop at the first value in range
+    const auto [low, high] = loop_exit_range(loop.condition);
+    std::uint64_t iterations = 1;
+    std::uint32_t result = entered;
+    if (entered - low > high - low) {
+        iterations += loop.step > 0 ? low - entered : entered - high;
+        result = loop.step > 0 ? low : high;
+    }
+
+    const std::uint64_t length = loop.update_count + 2;
+    if (iterations > max_instructions / length) {
+        return 0;
+    }
+
+    // Sums over the iterations. The counter, as an update reads it, moves
+    // by step each time, which adds up to a triangular number.
+    const auto counter = static_cast<std::uint32_t>(values[loop.counter]);
+    const auto triangle = iterations * (iterations - 1) / 2;
+    for (auto update = first; update != last; update++) {
+        std::uint32_t total = 0;
+        if (update->kind == OperandKind::IMM) {
+            total = static_cast<std::uint32_t>(
+                iterations * static_cast<std::uint32_t>(update->value));
+        } else if (update->value != loop.counter) {
+            total = static_cast<std::uint32_t>(
+                iterations *
+                static_cast<std::uint32_t>(values[update->value]));
+        } else {
+            const auto start =
+                counter + static_cast<std::uint32_t>(update->offset);
+            total = static_cast<std::uint32_t>(
+                iterations * start +
+                (loop.step > 0 ? triangle : 0 - triangle));
+        }
+        auto &target = values[update->slot];
+        target = static_cast<int>(update->code == OpCode::ADD
+                                      ? static_cast<std::uint32_t>(target) +
+                                            total
+                                      : static_cast<std::uint32_t>(target) -
+                                            total);
+    }
+    cmp_test = static_cast<int>(result);
+
+    return iterations * length;
+}
+
+auto optimize(Program &program, const OptimizerPasses &passes) -> void {
+    if (program.code.size() * (program.reg_names.size() + 1) >
+        analysis_limit) {
+        return;
+    }
+
+    const bool forward = passes.constant_propagation ||
+                         passes.copy_propagation ||
+                         passes.unreachable_blocks;
+
+    // Every round either changes the program or ends the loop, the bound
+    // is only a safety net
+    for (int round = 0; round < 64; round++) {
+        bool changed = false;
+
+        if (forward) {
+            const auto blocks = build_cfg(program);
+            const auto analysis = analyze(program, blocks);
+            std::vector<bool> removed(program.code.size(), false);
+
+            if (passes.constant_propagation || passes.copy_propagation) {
+                changed |=
+                    propagate(program, blocks, analysis, passes, removed);
+            }
+            if (passes.unreachable_blocks) {
+                remove_unreachable(program, blocks, analysis, removed);
+            }
+            changed |= compact(program, removed);
+        }
+
+        if (passes.dead_stores) {
+            const auto blocks = build_cfg(program);
+            const auto analysis = analyze(program, blocks);
+            std::vector<bool> removed(program.code.size(), false);
+
+            remove_dead_stores(program, blocks, analysis, removed);
+            changed |= compact(program, removed);
+        }
+
+        if (!changed) {
+            break;
+        }
+    }
+
+    if (passes.closed_form_loops) {
+        close_loops(program);
+    }
+    if (passes.pure_calls) {
+        mark_pure_calls(program);
+    }
+}
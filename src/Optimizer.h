@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Program.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Passes of optimize(), each enabled on its own. A default constructed
+// OptimizerPasses enables none.
+struct OptimizerPasses {
+    // Reads of registers holding a known constant become immediates,
+    // arithmetic on constants is folded into 'mov', and conditional jumps
+    // on a known comparison become 'jmp' or disappear.
+    bool constant_propagation = false;
+
+    // After 'mov a, b', reads of a read b for as long as neither changes.
+    bool copy_propagation = false;
+
+    // Removes writes to registers that are never read afterwards, and
+    // comparisons no jump tests. A run's final register values are then
+    // only reliable for registers the program reads.
+    bool dead_stores = false;
+
+    // Removes code no path from the first instruction reaches, and jumps
+    // to the next instruction.
+    bool unreachable_blocks = false;
+
+    // Counted loops, see ClosedLoop, get a CLOSED_LOOP entry that runs all
+    // of their iterations at once. The engines then run loops taking more
+    // instructions than they are allowed to, or reading an undefined
+    // register, as they are.
+    bool closed_form_loops = false;
+
+    // Calls of subroutines that are pure, see PureRoutine, are marked so
+    // the switch and threaded engines can memoize them.
+    bool pure_calls = false;
+
+    static constexpr auto all() -> OptimizerPasses {
+        return {true, true, true, true, true, true};
+    }
+};
+
+// Rewrites a program, before fuse_superinstructions(), with the enabled
+// passes of a control flow graph optimizer, until none of them changes
+// anything more. 'msg' output, errors (message and line) and whether the
+// program reaches 'end' stay exactly the same. Instructions an error can
+// come from are only removed when the error is proven impossible.
+// Loops are closed and pure calls marked last, so optimize() must not run
+// twice on a program.
+auto optimize(Program &program, const OptimizerPasses &passes) -> void;
+
+// Values of cmp_test a ClosedLoop with this condition ends on, from low up
+// to high, wrapping around past UINT32_MAX for JE and JG.
+auto loop_exit_range(const OpCode &condition)
+    -> std::pair<std::uint32_t, std::uint32_t>;
+
+// Runs a CLOSED_LOOP of program on registers and cmp_test, if every
+// register the loop reads is defined and its iterations take at most
+// max_instructions instructions. Returns how many instructions it stood
+// for, or 0 if it left everything untouched and the loop must run.
+auto run_closed_loop(const Program &program, const ClosedLoop &loop,
+                     int *values, const std::uint8_t *defined, int &cmp_test,
+                     const std::uint64_t &max_instructions) -> std::uint64_t;
+
+// Rewrites the hottest instruction sequences of loops into single
+// superinstructions:
+//  - cmp a, b / j<cc> L        -> CMP_J<cc>
+//  - inc/dec a / cmp a, b / j<cc> L -> INC_CMP_J<cc>, DEC_CMP_J<cc>
+// The fused instruction takes the place of the first one of the sequence
+// and skips over the rest, which stay in the code unchanged. No instruction
+// moves, so jump targets remain valid even when they point into the middle
+// of a fused sequence.
+auto fuse_superinstructions(Program &program) -> void;
+
+// The instruction a superinstruction stands for: running that one and the
+// instructions after it is the same as running the superinstruction.
+// Other opcodes are returned as they are.
+auto unfused(const OpCode &code) -> OpCode;
+
+// Marks the instructions control reaches other than from the one before:
+// jump and call targets, and return addresses. Together with the first
+// instruction they start the basic blocks of the program.
+auto find_leaders(const Program &program) -> std::vector<bool>;
@@ -0,0 +1,53 @@
+#include "OutputSink.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <unistd.h>
+
+FdSink::FdSink(int fd, size_t buffer_size) : fd(fd), buffer_size(buffer_size) {
+    buffer.reserve(buffer_size);
+}
+
+FdSink::~FdSink() {
+    try {
+        flush();
+    } catch (const std::exception &) { // Nowhere left to report it
+    }
+}
+
+auto FdSink::write(const std::string_view &text) -> void {
+    if (buffer.size() + text.size() > buffer_size) {
+        flush();
+    }
+    buffer += text; // May exceed buffer_size for a single large message
+}
+
+auto FdSink::flush() -> void {
+    const char *data = buffer.data();
+    size_t left = buffer.size();
+
+    while (left > 0) {
+        const ssize_t written = ::write(fd, data, left);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            buffer.clear();
+            throw std::runtime_error(std::string("Output write failed: ") +
+                                     std::strerror(errno));
+        }
+        data += written;
+        left -= static_cast<size_t>(written);
+    }
+
+    buffer.clear();
+}
+
+auto BoundedBufferSink::write(const std::string_view &text) -> void {
+    const size_t kept = std::min(text.size(), capacity - buffer.size());
+    buffer.append(text.data(), kept);
+    dropped_bytes += text.size() - kept;
+}
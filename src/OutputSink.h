@@ -0,0 +1,120 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+
+// Where the output of 'msg' goes. A Machine formats each 'msg' into one
+// piece of text and writes it as soon as the instruction runs, then flushes
+// once the run is over.
+class OutputSink {
+  public:
+    virtual ~OutputSink() = default;
+
+    virtual auto write(const std::string_view &text) -> void = 0;
+    virtual auto flush() -> void {}
+};
+
+// Collects everything into a string, what assembler_interpreter returns
+class StringSink : public OutputSink {
+  public:
+    auto write(const std::string_view &text) -> void override {
+        if (shared) { // Copy on write
+            buffer = *shared;
+            shared.reset();
+        }
+        buffer += text;
+    }
+
+    auto text() const noexcept -> const std::string & {
+        return shared ? *shared : buffer;
+    }
+    auto clear() noexcept -> void {
+        buffer.clear();
+        shared.reset();
+    }
+
+    // Starts over from text shared with other sinks, which is only copied
+    // once this one is written to
+    auto share(std::shared_ptr<const std::string> text) noexcept -> void {
+        buffer.clear();
+        shared = std::move(text);
+    }
+
+  private:
+    std::string buffer;
+    std::shared_ptr<const std::string> shared;
+};
+
+class StreamSink : public OutputSink {
+  public:
+    explicit StreamSink(std::ostream &stream) noexcept : stream(stream) {}
+
+    auto write(const std::string_view &text) -> void override {
+        stream.write(text.data(), static_cast<std::streamsize>(text.size()));
+    }
+
+    auto flush() -> void override { stream.flush(); }
+
+  private:
+    std::ostream &stream;
+};
+
+// Buffers up to buffer_size bytes between write(2) calls. Throws
+// std::runtime_error if the descriptor can't be written.
+class FdSink : public OutputSink {
+  public:
+    explicit FdSink(int fd, size_t buffer_size = 1 << 16);
+    ~FdSink() override;
+
+    FdSink(const FdSink &) = delete;
+    auto operator=(const FdSink &) -> FdSink & = delete;
+
+    auto write(const std::string_view &text) -> void override;
+    auto flush() -> void override;
+
+  private:
+    int fd;
+    size_t buffer_size;
+    std::string buffer;
+};
+
+// Hands every message to a callback, as it is produced
+class CallbackSink : public OutputSink {
+  public:
+    explicit CallbackSink(std::function<void(std::string_view)> callback)
+        : callback(std::move(callback)) {}
+
+    auto write(const std::string_view &text) -> void override {
+        callback(text);
+    }
+
+  private:
+    std::function<void(std::string_view)> callback;
+};
+
+// Keeps the first capacity bytes of output and counts the rest, so a
+// program printing in an endless loop can't exhaust memory.
+class BoundedBufferSink : public OutputSink {
+  public:
+    explicit BoundedBufferSink(size_t capacity) noexcept
+        : capacity(capacity) {}
+
+    auto write(const std::string_view &text) -> void override;
+
+    auto text() const noexcept -> const std::string & { return buffer; }
+    auto dropped() const noexcept -> size_t { return dropped_bytes; }
+    auto truncated() const noexcept -> bool { return dropped_bytes != 0; }
+    auto clear() noexcept -> void {
+        buffer.clear();
+        dropped_bytes = 0;
+    }
+
+  private:
+    size_t capacity;
+    size_t dropped_bytes = 0;
+    std::string buffer;
+};
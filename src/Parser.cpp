@@ -1,14 +1,29 @@
 #include "Errors.h"
 #include "Parser.h"
 
+#include <array>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
+// Column of a token of line, from 1, or 0 if it isn't one of line's
+static auto column(const std::string_view &line, const Token &token)
+    -> unsigned int {
+    const char *const position = token.token_data.data();
+    if (position < line.data() || position > line.data() + line.size()) {
+        return 0;
+    }
+    return static_cast<unsigned int>(position - line.data() + 1);
+}
+
 static auto parse_parameters(std::vector<Token>::iterator start_it,
                              std::vector<Token>::iterator end_it,
-                             const unsigned int &lineno)
-    -> std::vector<Parameter> {
-    std::vector<Parameter> paramemters;
+                             const std::string_view &line,
+                             const unsigned int &lineno,
+                             std::vector<Parameter> &paramemters,
+                             Diagnostic &diagnostic) -> bool {
+    paramemters.clear();
 
     for (auto it = start_it; it != end_it; it++) {
         if (TokenType tok_type = it->token_type;
@@ -20,329 +35,209 @@ static auto parse_parameters(std::vector<Token>::iterator start_it,
                     paramemters.push_back(std::move(*it));
                     it++;
                 } else {
-                    PARSE_ERR(lineno,
-                              "Error parsing '" +
-                                  std::string(std::next(it)->token_data) +
-                                  "', coma ',' expected!");
+                    return report(diagnostic, lineno,
+                                  column(line, *std::next(it)),
+                                  DiagnosticCode::EXPECTED_COMA,
+                                  "Error parsing '" +
+                                      std::string(std::next(it)->token_data) +
+                                      "', coma ',' expected!");
                 }
             } else { // End of paramemters
                 paramemters.push_back(std::move(*it));
             }
         } else {
-            PARSE_ERR(lineno,
-                      "Error parsing '" + std::string(it->token_data) + "'");
+            return report(diagnostic, lineno, column(line, *it),
+                          DiagnosticCode::UNEXPECTED_TOKEN,
+                          "Error parsing '" + std::string(it->token_data) +
+                              "'");
         }
     }
 
-    return paramemters;
+    return true;
 }
 
-auto parser(std::vector<Token> &tokens, const unsigned int &lineno)
-    -> Instruction {
-    if (tokens.empty()) {
-        PARSE_ERR(lineno, "Nothing to parse! This error shouldn't happen, "
-                          "Implementation error!");
-    }
+// Operand kinds an instruction accepts, as a set of TokenTypes
+using OperandKinds = unsigned int;
 
-    auto first_tok = tokens[0];
+constexpr auto kind(const TokenType &type) -> OperandKinds {
+    return 1U << static_cast<unsigned int>(type);
+}
 
-    if (first_tok.token_type != TokenType::IDENTIFIER) {
-        PARSE_ERR(lineno, "No instruction given");
+constexpr OperandKinds REG = kind(TokenType::IDENTIFIER);
+constexpr OperandKinds LABEL = kind(TokenType::IDENTIFIER);
+constexpr OperandKinds NUM = kind(TokenType::NUMBER);
+constexpr OperandKinds STR = kind(TokenType::STRING);
+
+constexpr int VARIADIC = -1; // Any number of operands, all of operands[0]
+
+struct InstructionDescriptor {
+    std::string_view mnemonic;
+    InstructionType ins_type;
+    int arity;
+    std::array<OperandKinds, 2> operands;
+};
+
+// Adding an instruction only takes a new row here
+constexpr std::array<InstructionDescriptor, 19> instruction_table{{
+    {"mov", InstructionType::MOV, 2, {REG, REG | NUM}},
+    {"inc", InstructionType::INC, 1, {REG}},
+    {"dec", InstructionType::DEC, 1, {REG}},
+    {"add", InstructionType::ADD, 2, {REG, REG | NUM}},
+    {"sub", InstructionType::SUB, 2, {REG, REG | NUM}},
+    {"mul", InstructionType::MUL, 2, {REG, REG | NUM}},
+    {"div", InstructionType::DIV, 2, {REG, REG | NUM}},
+    {"cmp", InstructionType::CMP, 2, {REG | NUM, REG | NUM}},
+    {"jmp", InstructionType::JMP, 1, {LABEL}},
+    {"jne", InstructionType::JNE, 1, {LABEL}},
+    {"je", InstructionType::JE, 1, {LABEL}},
+    {"jge", InstructionType::JGE, 1, {LABEL}},
+    {"jg", InstructionType::JG, 1, {LABEL}},
+    {"jle", InstructionType::JLE, 1, {LABEL}},
+    {"jl", InstructionType::JL, 1, {LABEL}},
+    {"call", InstructionType::CALL, 1, {LABEL}},
+    {"msg", InstructionType::MSG, VARIADIC, {REG | NUM | STR}},
+    {"ret", InstructionType::RET, 0, {}},
+    {"end", InstructionType::END, 0, {}},
+}};
+
+// Mnemonics are at most 4 bytes, packed into an integer they are looked up
+// in a perfect hash table: one multiply, one shift, one compare.
+constexpr auto pack_mnemonic(const std::string_view &mnemonic)
+    -> std::uint32_t {
+    if (mnemonic.size() > 4) {
+        return 0; // Never a mnemonic
     }
 
-    // Parsing the instruction type first
-    if (auto ins = first_tok.token_data; ins == "mov") {
-        auto paramemters =
-            parse_parameters(tokens.begin() + 1, tokens.end(), lineno);
-        if (paramemters.size() != 2) { // Arguments check
-            PARSE_ERR(lineno, "'mov' instruction requires 2 arguments, given " +
-                                  std::to_string(paramemters.size()) + ".");
-        }
-
-        if (!((paramemters[0].token_type == TokenType::IDENTIFIER) &&
-              ((paramemters[1].token_type == TokenType::IDENTIFIER) ||
-               (paramemters[1].token_type == TokenType::NUMBER)))) {
-            PARSE_ERR(lineno, "Invalid arguments given to 'mov' instruction.");
-        }
-
-        return {InstructionType::MOV, std::move(paramemters)};
-
-    } else if (ins == "inc") {
-        auto paramemters =
-            parse_parameters(tokens.begin() + 1, tokens.end(), lineno);
-
-        if (paramemters.size() != 1) { // Arguments check
-            PARSE_ERR(lineno, "'inc' instruction requires 1 arguments, given " +
-                                  std::to_string(paramemters.size()) + ".");
-        }
-
-        if (paramemters[0].token_type != TokenType::IDENTIFIER) {
-            PARSE_ERR(lineno, "Invalid arguments given to 'inc' instruction.");
-        }
-
-        return {InstructionType::INC, std::move(paramemters)};
-
-    } else if (ins == "dec") {
-        auto paramemters =
-            parse_parameters(tokens.begin() + 1, tokens.end(), lineno);
-
-        if (paramemters.size() != 1) {
-            PARSE_ERR(lineno, "'dec' instruction requires 1 arguments, given " +
-                                  std::to_string(paramemters.size()) + ".");
-        }
-
-        if (paramemters[0].token_type != TokenType::IDENTIFIER) {
-            PARSE_ERR(lineno, "Invalid arguments given to 'dec' instruction.");
-        }
-
-        return {InstructionType::DEC, std::move(paramemters)};
-
-    } else if (auto ins = first_tok.token_data; ins == "add") {
-        auto paramemters =
-            parse_parameters(tokens.begin() + 1, tokens.end(), lineno);
-        if (paramemters.size() != 2) {
-            PARSE_ERR(lineno, "'add' instruction requires 2 arguments, given " +
-                                  std::to_string(paramemters.size()) + ".");
-        }
-
-        if (!((paramemters[0].token_type == TokenType::IDENTIFIER) &&
-              ((paramemters[1].token_type == TokenType::IDENTIFIER) ||
-               (paramemters[1].token_type == TokenType::NUMBER)))) {
-            PARSE_ERR(lineno, "Invalid arguments given to 'add' instruction.");
-        }
-
-        return {InstructionType::ADD, std::move(paramemters)};
-
-    } else if (auto ins = first_tok.token_data; ins == "sub") {
-        auto paramemters =
-            parse_parameters(tokens.begin() + 1, tokens.end(), lineno);
-        if (paramemters.size() != 2) { // Arguments check
-            PARSE_ERR(lineno, "'sub' instruction requires 2 arguments, given " +
-                                  std::to_string(paramemters.size()) + ".");
-        }
-
-        if (!((paramemters[0].token_type == TokenType::IDENTIFIER) &&
-              ((paramemters[1].token_type == TokenType::IDENTIFIER) ||
-               (paramemters[1].token_type == TokenType::NUMBER)))) {
-            PARSE_ERR(lineno, "Invalid arguments given to 'sub' instruction.");
-        }
-
-        return {InstructionType::SUB, std::move(paramemters)};
-
-    } else if (auto ins = first_tok.token_data; ins == "mul") {
-        auto paramemters =
-            parse_parameters(tokens.begin() + 1, tokens.end(), lineno);
-        if (paramemters.size() != 2) { // Arguments check
-            PARSE_ERR(lineno, "'mul' instruction requires 2 arguments, given " +
-                                  std::to_string(paramemters.size()) + ".");
-        }
-
-        if (!((paramemters[0].token_type == TokenType::IDENTIFIER) &&
-              ((paramemters[1].token_type == TokenType::IDENTIFIER) ||
-               (paramemters[1].token_type == TokenType::NUMBER)))) {
-            PARSE_ERR(lineno, "Invalid arguments given to 'mul' instruction.");
-        }
-
-        return {InstructionType::MUL, std::move(paramemters)};
-
-    } else if (auto ins = first_tok.token_data; ins == "div") {
-        auto paramemters =
-            parse_parameters(tokens.begin() + 1, tokens.end(), lineno);
-
-        if (paramemters.size() != 2) { // Arguments check
-            PARSE_ERR(lineno, "'div' instruction requires 2 arguments, given " +
-                                  std::to_string(paramemters.size()) + ".");
-        }
-
-        if (!((paramemters[0].token_type == TokenType::IDENTIFIER) &&
-              ((paramemters[1].token_type == TokenType::IDENTIFIER) ||
-               (paramemters[1].token_type == TokenType::NUMBER)))) {
-            PARSE_ERR(lineno, "Invalid arguments given to 'div' instruction.");
-        }
-
-        return {InstructionType::DIV, std::move(paramemters)};
-
-    } else if (auto ins = first_tok.token_data; ins == "cmp") {
-        auto paramemters =
-            parse_parameters(tokens.begin() + 1, tokens.end(), lineno);
-
-        if (paramemters.size() != 2) { // Arguments check
-            PARSE_ERR(lineno, "'cmp' instruction requires 2 arguments, given " +
-                                  std::to_string(paramemters.size()) + ".");
-        }
-
-        if (!(((paramemters[0].token_type == TokenType::IDENTIFIER) ||
-               (paramemters[0].token_type == TokenType::NUMBER)) &&
-              ((paramemters[1].token_type == TokenType::IDENTIFIER) ||
-               (paramemters[1].token_type == TokenType::NUMBER)))) {
-            PARSE_ERR(lineno, "Invalid arguments given to 'cmp' instruction.");
-        }
-
-        return {InstructionType::CMP, std::move(paramemters)};
-
-    } else if (ins == "jmp") {
-        auto paramemters =
-            parse_parameters(tokens.begin() + 1, tokens.end(), lineno);
-
-        if (paramemters.size() != 1) { // Arguments check
-            PARSE_ERR(lineno, "'jmp' instruction requires 1 arguments, given " +
-                                  std::to_string(paramemters.size()) + ".");
-        }
-
-        if (paramemters[0].token_type != TokenType::IDENTIFIER) {
-            PARSE_ERR(lineno, "Invalid arguments given to 'jmp' instruction.");
-        }
-
-        return {InstructionType::JMP, std::move(paramemters)};
-
-    } else if (ins == "jne") {
-        auto paramemters =
-            parse_parameters(tokens.begin() + 1, tokens.end(), lineno);
-
-        if (paramemters.size() != 1) {
-            PARSE_ERR(lineno, "'jne' instruction requires 1 arguments, given " +
-                                  std::to_string(paramemters.size()) + ".");
-        }
-
-        if (paramemters[0].token_type != TokenType::IDENTIFIER) {
-            PARSE_ERR(lineno, "Invalid arguments given to 'jne' instruction.");
-        }
-
-        return {InstructionType::JNE, std::move(paramemters)};
-
-    } else if (ins == "je") {
-        auto paramemters =
-            parse_parameters(tokens.begin() + 1, tokens.end(), lineno);
-
-        if (paramemters.size() != 1) {
-            PARSE_ERR(lineno, "'je' instruction requires 1 arguments, given " +
-                                  std::to_string(paramemters.size()) + ".");
-        }
-
-        if (paramemters[0].token_type != TokenType::IDENTIFIER) {
-            PARSE_ERR(lineno, "Invalid arguments given to 'je' instruction.");
-        }
-
-        return {InstructionType::JE, std::move(paramemters)};
-
-    } else if (ins == "jge") {
-        auto paramemters =
-            parse_parameters(tokens.begin() + 1, tokens.end(), lineno);
-
-        if (paramemters.size() != 1) {
-            PARSE_ERR(lineno, "'jge' instruction requires 1 arguments, given " +
-                                  std::to_string(paramemters.size()) + ".");
-        }
-
-        if (paramemters[0].token_type != TokenType::IDENTIFIER) {
-            PARSE_ERR(lineno, "Invalid arguments given to 'jge' instruction.");
-        }
-
-        return {InstructionType::JGE, std::move(paramemters)};
-
-    } else if (ins == "jg") {
-        auto paramemters =
-            parse_parameters(tokens.begin() + 1, tokens.end(), lineno);
-
-        if (paramemters.size() != 1) {
-            PARSE_ERR(lineno, "'jg' instruction requires 1 arguments, given " +
-                                  std::to_string(paramemters.size()) + ".");
-        }
-
-        if (paramemters[0].token_type != TokenType::IDENTIFIER) {
-            PARSE_ERR(lineno, "Invalid arguments given to 'jg' instruction.");
-        }
-
-        return {InstructionType::JG, std::move(paramemters)};
+    std::uint32_t packed = 0;
+    for (size_t i = 0; i < mnemonic.size(); i++) {
+        packed |= static_cast<std::uint32_t>(
+                      static_cast<unsigned char>(mnemonic[i]))
+                  << (8 * i);
+    }
+    return packed;
+}
 
-    } else if (ins == "jle") {
-        auto paramemters =
-            parse_parameters(tokens.begin() + 1, tokens.end(), lineno);
+constexpr std::uint32_t mnemonic_hash_multiplier = 0xaae49349;
+constexpr size_t mnemonic_hash_bits = 5;
 
-        if (paramemters.size() != 1) { // Arguments check
-            PARSE_ERR(lineno, "'jle' instruction requires 1 arguments, given " +
-                                  std::to_string(paramemters.size()) + ".");
-        }
+constexpr auto mnemonic_hash(const std::uint32_t &packed) -> size_t {
+    return static_cast<std::uint32_t>(packed * mnemonic_hash_multiplier) >>
+           (32 - mnemonic_hash_bits);
+}
 
-        if (paramemters[0].token_type != TokenType::IDENTIFIER) {
-            PARSE_ERR(lineno, "Invalid arguments given to 'jle' instruction.");
-        }
+struct MnemonicSlot {
+    std::uint32_t packed = 0;
+    const InstructionDescriptor *descriptor = nullptr;
+};
 
-        return {InstructionType::JLE, std::move(paramemters)};
+using MnemonicTable = std::array<MnemonicSlot, 1U << mnemonic_hash_bits>;
 
-    } else if (ins == "jl") {
-        auto paramemters =
-            parse_parameters(tokens.begin() + 1, tokens.end(), lineno);
+constexpr auto make_mnemonic_table() -> MnemonicTable {
+    MnemonicTable table{};
+    for (const auto &descriptor : instruction_table) {
+        const auto packed = pack_mnemonic(descriptor.mnemonic);
+        table[mnemonic_hash(packed)] = {packed, &descriptor};
+    }
+    return table;
+}
 
-        if (paramemters.size() != 1) { // Arguments check
-            PARSE_ERR(lineno, "'jl' instruction requires 1 arguments, given " +
-                                  std::to_string(paramemters.size()) + ".");
-        }
+constexpr MnemonicTable mnemonic_table = make_mnemonic_table();
 
-        if (paramemters[0].token_type != TokenType::IDENTIFIER) {
-            PARSE_ERR(lineno, "Invalid arguments given to 'jl' instruction.");
-        }
-
-        return {InstructionType::JL, std::move(paramemters)};
+constexpr auto mnemonic_table_is_perfect() -> bool {
+    size_t used = 0;
+    for (const auto &slot : mnemonic_table) {
+        used += slot.descriptor != nullptr ? 1 : 0;
+    }
+    return used == instruction_table.size();
+}
 
-    } else if (ins == "call") {
-        auto paramemters =
-            parse_parameters(tokens.begin() + 1, tokens.end(), lineno);
+static_assert(mnemonic_table_is_perfect(),
+              "mnemonic hash collision, pick another multiplier");
 
-        if (paramemters.size() != 1) { // Arguments check
-            PARSE_ERR(lineno,
-                      "'call' instruction requires 1 arguments, given " +
-                          std::to_string(paramemters.size()) + ".");
-        }
+static auto find_instruction(const std::string_view &mnemonic)
+    -> const InstructionDescriptor * {
+    const auto packed = pack_mnemonic(mnemonic);
+    const auto &slot = mnemonic_table[mnemonic_hash(packed)];
 
-        if (paramemters[0].token_type != TokenType::IDENTIFIER) {
-            PARSE_ERR(lineno, "Invalid arguments given to 'call' instruction.");
-        }
+    // packed is 0 for anything too long, which never matches a used slot
+    return slot.packed == packed ? slot.descriptor : nullptr;
+}
 
-        return {InstructionType::CALL, std::move(paramemters)};
+auto parse(std::vector<Token> &tokens, const std::string_view &line,
+           const unsigned int &lineno, Instruction &instruction,
+           Diagnostic &diagnostic) -> bool {
+    auto &paramemters = instruction.paramemters;
+    auto first_tok = tokens[0];
 
-    } else if (ins == "msg") {
-        auto paramemters =
-            parse_parameters(tokens.begin() + 1, tokens.end(), lineno);
+    if (first_tok.token_type != TokenType::IDENTIFIER) {
+        return report(diagnostic, lineno, column(line, first_tok),
+                      DiagnosticCode::NO_INSTRUCTION, "No instruction given");
+    }
 
-        // No argument length check
-        for (auto &paramemter : paramemters) {
-            if ((paramemter.token_type != TokenType::IDENTIFIER) &&
-                (paramemter.token_type != TokenType::STRING) &&
-                (paramemter.token_type != TokenType::NUMBER)) {
-                PARSE_ERR(lineno,
-                          "Invalid arguments given to 'msg' instruction.");
+    // Parsing the instruction type first
+    if (const auto *descriptor = find_instruction(first_tok.token_data)) {
+        const auto mnemonic = [&descriptor] {
+            return std::string(descriptor->mnemonic);
+        };
+
+        if (!parse_parameters(tokens.begin() + 1, tokens.end(), line, lineno,
+                              paramemters, diagnostic)) {
+            return false;
+        }
+
+        if (descriptor->arity != VARIADIC &&
+            paramemters.size() != static_cast<size_t>(descriptor->arity)) {
+            return report(diagnostic, lineno, column(line, first_tok),
+                          DiagnosticCode::ARGUMENT_COUNT,
+                          "'" + mnemonic() + "' instruction requires " +
+                              std::to_string(descriptor->arity) +
+                              " arguments, given " +
+                              std::to_string(paramemters.size()) + ".");
+        }
+
+        for (size_t i = 0; i < paramemters.size(); i++) {
+            const auto allowed =
+                descriptor->operands[descriptor->arity == VARIADIC ? 0 : i];
+
+            if ((kind(paramemters[i].token_type) & allowed) == 0) {
+                return report(diagnostic, lineno, column(line, paramemters[i]),
+                              DiagnosticCode::INVALID_ARGUMENT,
+                              "Invalid arguments given to '" + mnemonic() +
+                                  "' instruction.");
             }
         }
 
-        return {InstructionType::MSG, std::move(paramemters)};
-
-    } else if (ins == "ret") {
-        auto paramemters =
-            parse_parameters(tokens.begin() + 1, tokens.end(), lineno);
-
-        if (!paramemters.empty()) { // Arguments check
-            PARSE_ERR(lineno, "'ret' instruction requires 0 arguments, given " +
-                                  std::to_string(paramemters.size()) + ".");
-        }
-
-        return {InstructionType::RET, std::move(paramemters)};
-
-    } else if (ins == "end") {
-        auto paramemters =
-            parse_parameters(tokens.begin() + 1, tokens.end(), lineno);
-
-        if (!paramemters.empty()) { // Arguments check
-            PARSE_ERR(lineno, "'end' instruction requires 0 arguments, given " +
-                                  std::to_string(paramemters.size()) + ".");
-        }
-
-        return {InstructionType::END, std::move(paramemters)};
+        instruction.ins_type = descriptor->ins_type;
 
     } else if ((tokens.size() == 2) &&
                (tokens[1].token_type == TokenType::COLON)) { // Handling labels
-        return {InstructionType::LABEL, {first_tok}};
+        instruction.ins_type = InstructionType::LABEL;
+        paramemters.assign(1, first_tok);
     } else { // Unknown instruction
-        PARSE_ERR(lineno, "Unknown Instruction Found.");
+        return report(diagnostic, lineno, column(line, first_tok),
+                      DiagnosticCode::UNKNOWN_INSTRUCTION,
+                      "Unknown Instruction Found.");
     }
+
+    return true;
+}
+
+auto parser(std::vector<Token> &tokens, const unsigned int &lineno,
+            Instruction &instruction) -> void {
+    if (tokens.empty()) {
+        PARSE_ERR(lineno, "Nothing to parse! This error shouldn't happen, "
+                          "Implementation error!");
+    }
+
+    if (Diagnostic diagnostic;
+        !parse(tokens, {}, lineno, instruction, diagnostic)) {
+        PARSE_ERR(lineno, diagnostic.message);
+    }
+}
+
+auto parser(std::vector<Token> &tokens, const unsigned int &lineno)
+    -> Instruction {
+    Instruction instruction(InstructionType::END);
+    parser(tokens, lineno, instruction);
+    return instruction;
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Diagnostic.h"
 #include "Tokenizer.h"
 
 #include <string>
@@ -51,3 +52,14 @@ struct Instruction {
 
 auto parser(std::vector<Token> &tokens, const unsigned int &lineno)
     -> Instruction;
+
+// Same as above, but reuses the parameter storage of 'instruction'
+auto parser(std::vector<Token> &tokens, const unsigned int &lineno,
+            Instruction &instruction) -> void;
+
+// Same as above, but returns false with the error in diagnostic instead of
+// throwing. tokens must not be empty; columns are counted in line, which
+// they were lexed from.
+auto parse(std::vector<Token> &tokens, const std::string_view &line,
+           const unsigned int &lineno, Instruction &instruction,
+           Diagnostic &diagnostic) -> bool;
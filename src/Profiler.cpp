@@ -0,0 +1,188 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+
+Profile::Profile(const Program &program)
+    : executed(program.code.size()), taken(program.code.size()),
+      not_taken(program.code.size()), calls(program.code.size()),
+      inclusive(program.code.size()), stacks{{0, 0}} {}
+
+auto Profile::enter(const std::uint32_t &target) -> void {
+    calls[target]++;
+    frames.emplace_back(current_stack, total);
+
+    const auto key =
+        (static_cast<std::uint64_t>(current_stack) << 32) | target;
+    if (auto search = stack_children.find(key);
+        search != stack_children.end()) {
+        current_stack = search->second;
+    } else {
+        const auto child = static_cast<std::uint32_t>(stacks.size());
+        stacks.push_back({current_stack, target});
+        stack_children.emplace(key, child);
+        current_stack = child;
+    }
+}
+
+auto Profile::leave() -> void {
+    if (frames.empty()) {
+        return;
+    }
+
+    inclusive[stacks[current_stack].target] += total - frames.back().second;
+    current_stack = frames.back().first;
+    frames.pop_back();
+}
+
+auto Profile::restart() -> void {
+    frames.clear();
+    current_stack = 0;
+}
+
+// Name of the label at a call target
+static auto label_name(const Program &program, const std::uint32_t &target)
+    -> std::string {
+    for (const auto &label : program.labels) {
+        if (label.target == target) {
+            return label.name;
+        }
+    }
+    return "@" + std::to_string(target);
+}
+
+static auto percent(const std::uint64_t &count, const std::uint64_t &total)
+    -> double {
+    return total == 0 ? 0.0 : 100.0 * count / total;
+}
+
+auto hot_spot_report(const Profile &profile, const Program &program,
+                     const std::string_view &source) -> std::string {
+    std::string report;
+    char row[256];
+
+    const auto append_row = [&report, &row](const int &size) {
+        report.append(row, std::min<size_t>(size, sizeof(row) - 1));
+    };
+
+    append_row(std::snprintf(row, sizeof(row),
+                             "Instructions executed: %llu\n\n",
+                             static_cast<unsigned long long>(profile.total)));
+
+    // Per line. Every instruction sits on a line of its own.
+    std::map<std::uint32_t, size_t> line_ops;
+    for (size_t i = 0; i < program.code.size(); i++) {
+        if (program.code[i].code != OpCode::HALT &&
+            program.code[i].code != OpCode::CLOSED_LOOP) {
+            line_ops.emplace(program.code[i].line, i);
+        }
+    }
+
+    std::vector<std::string_view> lines;
+    for (size_t first = 0; first < source.size();) {
+        const size_t last = std::min(source.find('\n', first), source.size());
+        lines.push_back(source.substr(first, last - first));
+        first = last + 1;
+    }
+
+    append_row(std::snprintf(row, sizeof(row), "%6s %12s %7s %21s  %s\n",
+                             "Line", "Count", "%", "Taken/Not taken",
+                             "Source"));
+
+    const std::uint32_t line_count = std::max<std::uint32_t>(
+        static_cast<std::uint32_t>(lines.size()),
+        line_ops.empty() ? 0 : line_ops.rbegin()->first);
+
+    for (std::uint32_t line = 1; line <= line_count; line++) {
+        std::string_view text;
+        if (line <= lines.size()) {
+            text = lines[line - 1];
+            text.remove_prefix(
+                std::min(text.find_first_not_of(" \t"), text.size()));
+        }
+
+        const auto search = line_ops.find(line);
+        if (search == line_ops.end()) {
+            if (!text.empty()) {
+                append_row(std::snprintf(
+                    row, sizeof(row), "%6u %12s %7s %21s  %.*s\n", line, "",
+                    "", "", static_cast<int>(text.size()), text.data()));
+            }
+            continue;
+        }
+
+        const size_t i = search->second;
+        char branch[32] = "";
+        if (profile.taken[i] + profile.not_taken[i] != 0) {
+            std::snprintf(branch, sizeof(branch), "%llu/%llu",
+                          static_cast<unsigned long long>(profile.taken[i]),
+                          static_cast<unsigned long long>(
+                              profile.not_taken[i]));
+        }
+
+        append_row(std::snprintf(
+            row, sizeof(row), "%6u %12llu %7.2f %21s  %.*s\n", line,
+            static_cast<unsigned long long>(profile.executed[i]),
+            percent(profile.executed[i], profile.total), branch,
+            static_cast<int>(text.size()), text.data()));
+    }
+
+    // Per label: instructions up to the next label, and calls to it
+    std::vector<Label> labels = program.labels;
+    std::stable_sort(labels.begin(), labels.end(),
+                     [](const Label &lhs, const Label &rhs) {
+                         return lhs.target < rhs.target;
+                     });
+    labels.insert(labels.begin(), Label{"<entry>", 0});
+
+    append_row(std::snprintf(row, sizeof(row), "\n%-24s %14s %7s %10s %14s\n",
+                             "Label", "Instructions", "%", "Calls",
+                             "Inclusive"));
+
+    for (size_t l = 0; l < labels.size(); l++) {
+        const size_t first = labels[l].target;
+        const size_t last =
+            l + 1 < labels.size() ? labels[l + 1].target : program.code.size();
+
+        std::uint64_t count = 0;
+        for (size_t i = first; i < last; i++) {
+            count += profile.executed[i];
+        }
+
+        const bool is_target = first < program.code.size() && l > 0;
+        append_row(std::snprintf(
+            row, sizeof(row), "%-24s %14llu %7.2f %10llu %14llu\n",
+            labels[l].name.c_str(), static_cast<unsigned long long>(count),
+            percent(count, profile.total),
+            static_cast<unsigned long long>(
+                is_target ? profile.calls[first] : 0),
+            static_cast<unsigned long long>(
+                is_target ? profile.inclusive[first] : 0)));
+    }
+
+    return report;
+}
+
+auto collapsed_stacks(const Profile &profile, const Program &program)
+    -> std::string {
+    std::string collapsed;
+    std::vector<std::string> names(profile.stacks.size());
+
+    // Parents always come before their children
+    names[0] = "main";
+    for (size_t node = 1; node < profile.stacks.size(); node++) {
+        const auto &stack = profile.stacks[node];
+        names[node] =
+            names[stack.parent] + ";" + label_name(program, stack.target);
+    }
+
+    for (size_t node = 0; node < profile.stacks.size(); node++) {
+        if (profile.stacks[node].self != 0) {
+            collapsed += names[node] + " " +
+                         std::to_string(profile.stacks[node].self) + "\n";
+        }
+    }
+
+    return collapsed;
+}
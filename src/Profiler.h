@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Program.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// What Machine::run_profiled() records, accumulated over any number of runs
+// of one program. Fused instructions are counted as the instructions they
+// replace, so counts always refer to the program as written.
+struct Profile {
+    explicit Profile(const Program &program);
+
+    std::uint64_t total = 0; // Instructions executed
+
+    // Indexed by instruction
+    std::vector<std::uint64_t> executed;
+    std::vector<std::uint64_t> taken; // Conditional jumps only
+    std::vector<std::uint64_t> not_taken;
+
+    // Indexed by call target instruction. Inclusive counts include every
+    // instruction from the call to its 'ret', recursive calls included.
+    std::vector<std::uint64_t> calls;
+    std::vector<std::uint64_t> inclusive;
+
+    // Tree of the call stacks seen, stacks[0] being the program's entry.
+    // self counts the instructions executed with exactly that stack.
+    struct StackNode {
+        std::uint32_t parent;
+        std::uint32_t target; // Call target instruction
+        std::uint64_t self = 0;
+    };
+    std::vector<StackNode> stacks;
+
+    auto step(const size_t &index) -> void {
+        executed[index]++;
+        stacks[current_stack].self++;
+        total++;
+    }
+
+    auto branch(const size_t &index, const bool &was_taken) -> void {
+        (was_taken ? taken : not_taken)[index]++;
+    }
+
+    auto enter(const std::uint32_t &target) -> void;
+    auto leave() -> void;
+
+    // Forgets the call stack of an unfinished run, keeps the counts
+    auto restart() -> void;
+
+  private:
+    std::unordered_map<std::uint64_t, std::uint32_t> stack_children;
+    // Per active call: the caller's stack node and the total at the call
+    std::vector<std::pair<std::uint32_t, std::uint64_t>> frames;
+    std::uint32_t current_stack = 0;
+};
+
+// Hot spots: every source line that ran with its count, share of the total
+// and branch behaviour, followed by instructions and calls per label. The
+// source is optional, to print each line's text next to its counts.
+auto hot_spot_report(const Profile &profile, const Program &program,
+                     const std::string_view &source = {}) -> std::string;
+
+// One "frame;frame;frame count" line per call stack, the input format of
+// flamegraph.pl and compatible tools.
+auto collapsed_stacks(const Profile &profile, const Program &program)
+    -> std::string;
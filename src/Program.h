@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Version of the in-memory layout of Op, MsgArg, ClosedLoop, LoopUpdate,
+// PureRoutine and the OpCode numbering.
+// Bump it on any change to them, it invalidates cached programs on disk.
+constexpr std::uint32_t program_format_version = 7;
+
+// Opcodes of the compiled program. Labels don't survive compilation, jumps
+// carry the index of the instruction they continue at instead.
+enum class OpCode : std::uint8_t {
+    MOV,
+    INC,
+    DEC,
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    JMP,
+    CMP,
+    JNE,
+    JE,
+    JGE,
+    JG,
+    JLE,
+    JL,
+    CALL,
+    RET,
+    MSG,
+    END,
+    HALT, // Appended after the last instruction, the program ran off its end
+    INVALID_INTEGER, // Had a number no int holds, fails only when it runs,
+                     // after reading its registers in msg_args
+
+    // Superinstructions, see Optimizer.h. They replace the first
+    // instruction of the sequence they fuse, which stays in the code after
+    // them in case something jumps into its middle.
+    CMP_JNE, // cmp a, b / jne target
+    CMP_JE,
+    CMP_JGE,
+    CMP_JG,
+    CMP_JLE,
+    CMP_JL,
+    INC_CMP_JNE, // inc a / cmp a, b / jne target
+    INC_CMP_JE,
+    INC_CMP_JGE,
+    INC_CMP_JG,
+    INC_CMP_JLE,
+    INC_CMP_JL,
+    DEC_CMP_JNE, // dec a / cmp a, b / jne target
+    DEC_CMP_JE,
+    DEC_CMP_JGE,
+    DEC_CMP_JG,
+    DEC_CMP_JLE,
+    DEC_CMP_JL,
+
+    // Entry of a counted loop, see ClosedLoop. Stands for every iteration
+    // of the loop when it can, and falls through into the loop otherwise.
+    CLOSED_LOOP
+};
+
+enum class OperandKind : std::uint8_t { NONE, REG, IMM, STR };
+
+// Run time checks of an instruction, see verify(). An instruction keeps
+// those no analysis of the program could prove always pass.
+enum OpCheck : std::uint8_t {
+    CHECK_A = 1,       // Register a, or any register 'msg' prints, is defined
+    CHECK_B = 2,       // Register b is defined
+    CHECK_DIVISOR = 4, // The divisor of 'div' isn't 0
+    CHECK_STACK = 8,   // 'ret' has somewhere to return to
+    ALL_CHECKS = 15
+};
+
+// A single fixed-size instruction.
+//  - a, b:   register slot (REG) or decoded immediate (IMM).
+//  - target: jump/call destination, first msg_args entry for MSG and
+//            INVALID_INTEGER, in which case a holds the argument count, or
+//            loops entry for CLOSED_LOOP.
+// A CALL whose a is an IMM calls a PureRoutine, a indexes pure_routines.
+struct Op {
+    OpCode code;
+    OperandKind a_kind = OperandKind::NONE;
+    OperandKind b_kind = OperandKind::NONE;
+    std::uint8_t checks = ALL_CHECKS; // OpChecks it still needs
+    std::int32_t a = 0;
+    std::int32_t b = 0;
+    std::uint32_t target = 0;
+    std::uint32_t line = 0; // Source line, for diagnostics
+};
+
+// Side table entry for the variable length argument list of 'msg'.
+//  - REG/IMM: value is the register slot or the immediate.
+//  - STR:     value is the offset into Program::strings, size its length.
+struct MsgArg {
+    OperandKind kind;
+    std::int32_t value = 0;
+    std::uint32_t size = 0;
+};
+
+// Side table entry for CLOSED_LOOP, a loop of a single block
+//     head: <updates> / cmp counter, bound / j<cc> head
+// whose updates only add constants, registers the loop never writes or
+// the counter (inc, dec, add, sub), and which adds exactly 1 or -1 to
+// counter on every iteration. The number of iterations then follows from
+// the registers on entry, and so does every register and cmp_test on exit.
+struct ClosedLoop {
+    std::int32_t counter = 0;
+    std::int32_t step = 1; // Added to counter per iteration, 1 or -1
+    OperandKind bound_kind = OperandKind::IMM;
+    std::int32_t bound = 0;
+    OpCode condition = OpCode::JNE; // The loop goes on while it jumps
+    std::uint32_t first_update = 0; // Into Program::loop_updates
+    std::uint32_t update_count = 0;
+    std::uint32_t exit = 0; // Instruction after the loop
+};
+
+// One update of a ClosedLoop: slot += value, or -= for SUB
+struct LoopUpdate {
+    OpCode code; // ADD or SUB
+    OperandKind kind; // IMM or REG
+    std::int32_t slot = 0;
+    std::int32_t value = 0;
+    // Reading the counter, what the iteration added to it before
+    std::int32_t offset = 0;
+};
+
+// Most registers a PureRoutine may use
+constexpr std::uint32_t max_pure_slots = 16;
+
+// Side table entry for a subroutine whose calls can be memoized: it never
+// writes output or stops the program, and what it does to registers and
+// cmp_test only depends on them. A recorded call can then stand for any
+// later one on the same registers.
+struct PureRoutine {
+    std::uint32_t first_slot = 0; // Into Program::pure_slots
+    std::uint32_t slot_count = 0; // Registers it, or what it calls, uses
+    std::uint32_t written = 0;    // Bit i: it may write the i-th of them
+    bool reads_cmp_test = false;  // Can test cmp_test before setting it
+    bool writes_cmp_test = false;
+};
+
+struct Label {
+    std::string name;
+    std::uint32_t target;
+};
+
+// A compiled program. It is never modified after compile(), so it can be
+// shared between threads and reused for any number of runs.
+struct Program {
+    std::vector<Op> code;
+    std::vector<MsgArg> msg_args;
+    std::string strings;                // String literals used by 'msg'
+    std::vector<std::string> reg_names; // Indexed by register slot
+    std::vector<Label> labels;
+    std::vector<ClosedLoop> loops;
+    std::vector<LoopUpdate> loop_updates;
+    std::vector<PureRoutine> pure_routines;
+    std::vector<std::int32_t> pure_slots; // Register slots, ascending
+    bool verified = false; // Op::checks are verify()'s, not ALL_CHECKS
+
+    // Slot of the named register, -1 if the program doesn't use it
+    auto register_slot(const std::string_view &name) const -> std::int32_t {
+        for (size_t slot = 0; slot < reg_names.size(); slot++) {
+            if (reg_names[slot] == name) {
+                return static_cast<std::int32_t>(slot);
+            }
+        }
+        return -1;
+    }
+};
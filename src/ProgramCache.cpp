@@ -0,0 +1,526 @@
+#include "ProgramCache.h"
+#include "Compiler.h"
+#include "Optimizer.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char cache_magic[8] = {'A', 'S', 'M', 'P', 'R', 'G', '\0', '\0'};
+
+// Sections follow the header in this order, each padded to 8 bytes:
+// code, msg_args, strings, loops, loop_updates, pure_routines, pure_slots,
+// then register names
+// (u32 size, bytes) and labels (u32 target, u32 size, bytes).
+struct CacheHeader {
+    char magic[8];
+    std::uint32_t format_version;
+    std::uint32_t op_size;
+    std::uint32_t msg_arg_size;
+    std::uint32_t code_count;
+    std::uint32_t msg_arg_count;
+    std::uint32_t strings_size;
+    std::uint32_t reg_count;
+    std::uint32_t label_count;
+    std::uint32_t loop_count;
+    std::uint32_t loop_update_count;
+    std::uint32_t pure_routine_count;
+    std::uint32_t pure_slot_count;
+    std::uint32_t verified; // 1 if Op::checks are verify()'s, else 0
+    std::uint64_t source_hash;
+    std::uint64_t source_size;
+    std::uint64_t payload_size;
+    std::uint64_t payload_checksum;
+};
+
+static_assert(sizeof(CacheHeader) % 8 == 0, "CacheHeader must stay padded");
+static_assert(std::is_trivially_copyable<Op>::value &&
+                  std::is_trivially_copyable<MsgArg>::value &&
+                  std::is_trivially_copyable<ClosedLoop>::value &&
+                  std::is_trivially_copyable<LoopUpdate>::value &&
+                  std::is_trivially_copyable<PureRoutine>::value,
+              "Op, MsgArg and the side tables are stored as raw bytes");
+
+constexpr auto padded(const size_t &size) -> size_t {
+    return (size + 7) & ~static_cast<size_t>(7);
+}
+
+// Read only view of a whole file, unmapped when it goes out of scope
+class MappedFile {
+  public:
+    explicit MappedFile(const std::string &path) {
+        const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+
+        struct stat info {};
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void *mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE,
+                                fd, 0);
+            if (mapped != MAP_FAILED) {
+                data = static_cast<const char *>(mapped);
+                size = info.st_size;
+            }
+        }
+        close(fd);
+    }
+
+    ~MappedFile() {
+        if (data != nullptr) {
+            munmap(const_cast<char *>(data), size);
+        }
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    auto operator=(const MappedFile &) -> MappedFile & = delete;
+
+    const char *data = nullptr;
+    size_t size = 0;
+};
+
+// Bounds checked cursor over the mapped payload
+struct Reader {
+    const char *position;
+    const char *end;
+
+    auto take(const size_t &size) -> const char * {
+        if (static_cast<size_t>(end - position) < size) {
+            return nullptr;
+        }
+        const char *taken = position;
+        position += size;
+        return taken;
+    }
+
+    auto take_u32(std::uint32_t &value) -> bool {
+        const char *bytes = take(sizeof(value));
+        if (bytes == nullptr) {
+            return false;
+        }
+        std::memcpy(&value, bytes, sizeof(value));
+        return true;
+    }
+
+    template <typename T>
+    auto take_array(const size_t &count, std::vector<T> &values) -> bool {
+        const char *bytes = take(padded(count * sizeof(T)));
+        if (bytes == nullptr) {
+            return false;
+        }
+        values.resize(count);
+        std::memcpy(values.data(), bytes, count * sizeof(T));
+        return true;
+    }
+
+    auto take_string(std::string &value) -> bool {
+        std::uint32_t size = 0;
+        const char *bytes = nullptr;
+        if (!take_u32(size) || (bytes = take(size)) == nullptr) {
+            return false;
+        }
+        value.assign(bytes, size);
+        return true;
+    }
+};
+
+// Operands an engine reads as a value, a register or an immediate
+auto is_value(const OperandKind &kind) -> bool {
+    return kind == OperandKind::REG || kind == OperandKind::IMM;
+}
+
+// Whether op has a valid opcode and operands of the kinds it takes, so
+// that only REG operands ever index the registers. Slots, targets and side
+// table indices are bounded separately.
+auto valid_operands(const Op &op) -> bool {
+    if (op.code > OpCode::CLOSED_LOOP || op.a_kind > OperandKind::STR ||
+        op.b_kind > OperandKind::STR) {
+        return false;
+    }
+
+    switch (unfused(op.code)) {
+    case OpCode::MOV:
+    case OpCode::ADD:
+    case OpCode::SUB:
+    case OpCode::MUL:
+    case OpCode::DIV:
+        return op.a_kind == OperandKind::REG && is_value(op.b_kind);
+    case OpCode::INC:
+    case OpCode::DEC:
+        // Fused with a cmp, b is what the register is compared to
+        return op.a_kind == OperandKind::REG &&
+               (unfused(op.code) == op.code || is_value(op.b_kind));
+    case OpCode::CMP:
+        return is_value(op.a_kind) && is_value(op.b_kind);
+    case OpCode::CALL:
+        return op.a_kind == OperandKind::NONE ||
+               op.a_kind == OperandKind::IMM;
+    default:
+        return true;
+    }
+}
+
+// Whether an engine can safely leave out what the loaded Op::checks leave
+// out. Checks of register reads only decide whether reading one undefined
+// fails, so they are taken as verify() proved them. A 'div' may only leave
+// out its check of an immediate divisor other than 0, and a 'ret' its check
+// of the stack only if the first instruction can't reach it outside a
+// call, which a walk of the code finds much faster than verify() could
+// prove everything again.
+auto valid_checks(const Program &program) -> bool {
+    const auto &code = program.code;
+    if (!program.verified) {
+        return true; // Every check is made anyway
+    }
+
+    std::vector<std::uint8_t> reached(code.size());
+    std::vector<std::uint32_t> worklist;
+    const auto reach = [&](const std::uint32_t &index) {
+        if (!reached[index]) {
+            reached[index] = true;
+            worklist.push_back(index);
+        }
+    };
+
+    // Steps over calls, as verify() does. A superinstruction is taken as
+    // its first instruction, which the code after it completes.
+    reach(0);
+    while (!worklist.empty()) {
+        const auto index = worklist.back();
+        worklist.pop_back();
+        const Op &op = code[index];
+
+        switch (op.code) {
+        case OpCode::JMP:
+            reach(op.target);
+            continue;
+        case OpCode::JNE:
+        case OpCode::JE:
+        case OpCode::JGE:
+        case OpCode::JG:
+        case OpCode::JLE:
+        case OpCode::JL:
+            reach(op.target);
+            break;
+        case OpCode::CLOSED_LOOP:
+            reach(program.loops[op.target].exit);
+            break;
+        case OpCode::RET:
+        case OpCode::END:
+        case OpCode::HALT:
+        case OpCode::INVALID_INTEGER:
+            continue;
+        default:
+            break;
+        }
+        reach(index + 1); // Inside the code, which ends with HALT
+    }
+
+    for (size_t i = 0; i < code.size(); i++) {
+        const Op &op = code[i];
+        const bool unchecked_divisor =
+            op.code == OpCode::DIV && (op.checks & CHECK_DIVISOR) == 0 &&
+            (op.b_kind != OperandKind::IMM || op.b == 0);
+        const bool unchecked_stack = op.code == OpCode::RET &&
+                                     (op.checks & CHECK_STACK) == 0 &&
+                                     reached[i];
+        if ((op.checks & ~ALL_CHECKS) != 0 || unchecked_divisor ||
+            unchecked_stack) {
+            return false;
+        }
+    }
+    return true;
+}
+
+auto append_raw(std::string &buffer, const void *data, const size_t &size)
+    -> void {
+    buffer.append(static_cast<const char *>(data), size);
+}
+
+auto append_u32(std::string &buffer, const std::uint32_t &value) -> void {
+    append_raw(buffer, &value, sizeof(value));
+}
+
+auto append_padded(std::string &buffer, const void *data, const size_t &size)
+    -> void {
+    append_raw(buffer, data, size);
+    buffer.append(padded(size) - size, '\0');
+}
+
+} // namespace
+
+auto fnv1a_hash(const void *data, const size_t &size,
+                std::uint64_t hash) noexcept -> std::uint64_t {
+    const auto *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+auto load_program(const std::string &path, const std::uint64_t &source_hash,
+                  const std::uint64_t &source_size, Program &program) -> bool {
+    const MappedFile file(path);
+    if (file.data == nullptr || file.size < sizeof(CacheHeader)) {
+        return false;
+    }
+
+    CacheHeader header{};
+    std::memcpy(&header, file.data, sizeof(header));
+
+    // Stale: written by another format, or for another source
+    if (std::memcmp(header.magic, cache_magic, sizeof(cache_magic)) != 0 ||
+        header.format_version != program_format_version ||
+        header.op_size != sizeof(Op) ||
+        header.msg_arg_size != sizeof(MsgArg) ||
+        header.source_hash != source_hash ||
+        header.source_size != source_size || header.verified > 1) {
+        return false;
+    }
+
+    // Corrupt: truncated, or bytes changed since it was written
+    const char *payload = file.data + sizeof(header);
+    if (header.payload_size != file.size - sizeof(header) ||
+        fnv1a_hash(payload, header.payload_size) !=
+            header.payload_checksum) {
+        return false;
+    }
+
+    Reader reader{payload, payload + header.payload_size};
+    Program loaded;
+
+    const char *strings = nullptr;
+    if (!reader.take_array(header.code_count, loaded.code) ||
+        !reader.take_array(header.msg_arg_count, loaded.msg_args) ||
+        (strings = reader.take(padded(header.strings_size))) == nullptr) {
+        return false;
+    }
+    loaded.strings.assign(strings, header.strings_size);
+    if (!reader.take_array(header.loop_count, loaded.loops) ||
+        !reader.take_array(header.loop_update_count, loaded.loop_updates) ||
+        !reader.take_array(header.pure_routine_count, loaded.pure_routines) ||
+        !reader.take_array(header.pure_slot_count, loaded.pure_slots)) {
+        return false;
+    }
+
+    loaded.reg_names.resize(header.reg_count);
+    for (auto &name : loaded.reg_names) {
+        if (!reader.take_string(name)) {
+            return false;
+        }
+    }
+
+    loaded.labels.resize(header.label_count);
+    for (auto &label : loaded.labels) {
+        if (!reader.take_u32(label.target) || !reader.take_string(label.name) ||
+            label.target >= header.code_count) {
+            return false;
+        }
+    }
+
+    // A checksum can't catch a file written wrong in the first place, so
+    // make sure the code can't send the interpreter out of bounds.
+    if (loaded.code.empty() || loaded.code.back().code != OpCode::HALT) {
+        return false;
+    }
+    const auto valid_slot = [&](const OperandKind &kind,
+                                const std::int32_t &value) {
+        return kind != OperandKind::REG ||
+               static_cast<std::uint32_t>(value) < header.reg_count;
+    };
+    for (const auto &op : loaded.code) {
+        // Indexes msg_args for MSG, loops for CLOSED_LOOP, otherwise code
+        const bool valid_target =
+            op.code == OpCode::MSG || op.code == OpCode::INVALID_INTEGER
+                ? op.target <= header.msg_arg_count &&
+                      static_cast<std::uint32_t>(op.a) <=
+                          header.msg_arg_count - op.target
+            : op.code == OpCode::CLOSED_LOOP
+                ? op.target < header.loop_count
+                : op.target < header.code_count;
+        if (!valid_operands(op) || !valid_target ||
+            !valid_slot(op.a_kind, op.a) || !valid_slot(op.b_kind, op.b) ||
+            (op.code == OpCode::CALL && op.a_kind == OperandKind::IMM &&
+             static_cast<std::uint32_t>(op.a) >= header.pure_routine_count)) {
+            return false;
+        }
+    }
+    for (const auto &arg : loaded.msg_args) {
+        if (arg.kind == OperandKind::NONE || arg.kind > OperandKind::STR ||
+            !valid_slot(arg.kind, arg.value) ||
+            (arg.kind == OperandKind::STR &&
+             (static_cast<std::uint32_t>(arg.value) > header.strings_size ||
+              arg.size > header.strings_size -
+                             static_cast<std::uint32_t>(arg.value)))) {
+            return false;
+        }
+    }
+    for (const auto &loop : loaded.loops) {
+        if (loop.exit >= loaded.code.size() ||
+            (loop.step != 1 && loop.step != -1) ||
+            loop.condition < OpCode::JNE || loop.condition > OpCode::JL ||
+            !is_value(loop.bound_kind) ||
+            !valid_slot(OperandKind::REG, loop.counter) ||
+            !valid_slot(loop.bound_kind, loop.bound) ||
+            loop.first_update > header.loop_update_count ||
+            loop.update_count > header.loop_update_count - loop.first_update) {
+            return false;
+        }
+    }
+    for (const auto &update : loaded.loop_updates) {
+        if ((update.code != OpCode::ADD && update.code != OpCode::SUB) ||
+            !is_value(update.kind) ||
+            !valid_slot(OperandKind::REG, update.slot) ||
+            !valid_slot(update.kind, update.value)) {
+            return false;
+        }
+    }
+
+    for (const auto &routine : loaded.pure_routines) {
+        if (routine.slot_count > max_pure_slots ||
+            routine.first_slot > header.pure_slot_count ||
+            routine.slot_count > header.pure_slot_count - routine.first_slot) {
+            return false;
+        }
+    }
+    for (const auto &slot : loaded.pure_slots) {
+        if (!valid_slot(OperandKind::REG, slot)) {
+            return false;
+        }
+    }
+
+    // The checks verify() proved unneeded are kept, not proven again
+    loaded.verified = header.verified != 0;
+    if (!valid_checks(loaded)) {
+        return false;
+    }
+
+    program = std::move(loaded);
+    return true;
+}
+
+auto save_program(const std::string &path, const std::uint64_t &source_hash,
+                  const std::uint64_t &source_size, const Program &program)
+    -> bool {
+    std::string payload;
+    append_padded(payload, program.code.data(),
+                  program.code.size() * sizeof(Op));
+    append_padded(payload, program.msg_args.data(),
+                  program.msg_args.size() * sizeof(MsgArg));
+    append_padded(payload, program.strings.data(), program.strings.size());
+    append_padded(payload, program.loops.data(),
+                  program.loops.size() * sizeof(ClosedLoop));
+    append_padded(payload, program.loop_updates.data(),
+                  program.loop_updates.size() * sizeof(LoopUpdate));
+    append_padded(payload, program.pure_routines.data(),
+                  program.pure_routines.size() * sizeof(PureRoutine));
+    append_padded(payload, program.pure_slots.data(),
+                  program.pure_slots.size() * sizeof(std::int32_t));
+
+    for (const auto &name : program.reg_names) {
+        append_u32(payload, static_cast<std::uint32_t>(name.size()));
+        append_raw(payload, name.data(), name.size());
+    }
+    for (const auto &label : program.labels) {
+        append_u32(payload, label.target);
+        append_u32(payload, static_cast<std::uint32_t>(label.name.size()));
+        append_raw(payload, label.name.data(), label.name.size());
+    }
+
+    CacheHeader header{};
+    std::memcpy(header.magic, cache_magic, sizeof(cache_magic));
+    header.format_version = program_format_version;
+    header.op_size = sizeof(Op);
+    header.msg_arg_size = sizeof(MsgArg);
+    header.code_count = static_cast<std::uint32_t>(program.code.size());
+    header.msg_arg_count = static_cast<std::uint32_t>(program.msg_args.size());
+    header.strings_size = static_cast<std::uint32_t>(program.strings.size());
+    header.reg_count = static_cast<std::uint32_t>(program.reg_names.size());
+    header.label_count = static_cast<std::uint32_t>(program.labels.size());
+    header.loop_count = static_cast<std::uint32_t>(program.loops.size());
+    header.loop_update_count =
+        static_cast<std::uint32_t>(program.loop_updates.size());
+    header.pure_routine_count =
+        static_cast<std::uint32_t>(program.pure_routines.size());
+    header.pure_slot_count =
+        static_cast<std::uint32_t>(program.pure_slots.size());
+    header.verified = program.verified ? 1 : 0;
+    header.source_hash = source_hash;
+    header.source_size = source_size;
+    header.payload_size = payload.size();
+    header.payload_checksum = fnv1a_hash(payload.data(), payload.size());
+
+    // Written under a temporary name and renamed over the old entry, so a
+    // concurrent reader never maps a half written file. The name is unique
+    // to this writer, threads of one process saving together included.
+    std::string temp_path = path + ".XXXXXX";
+    const int fd = mkstemp(temp_path.data());
+    if (fd < 0) {
+        return false;
+    }
+    fchmod(fd, 0644); // mkstemp() makes it private to the user
+
+    std::FILE *file = fdopen(fd, "wb");
+    if (file == nullptr) {
+        close(fd);
+        std::remove(temp_path.c_str());
+        return false;
+    }
+
+    const bool written =
+        std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+        std::fwrite(payload.data(), 1, payload.size(), file) ==
+            payload.size();
+
+    if (std::fclose(file) != 0 || !written ||
+        std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        std::remove(temp_path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+ProgramCache::ProgramCache(std::string directory)
+    : directory(std::move(directory)) {
+    mkdir(this->directory.c_str(), 0755); // Fine if it already exists
+}
+
+auto ProgramCache::path_for(const std::string_view &source) const
+    -> std::string {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.asmc",
+                  static_cast<unsigned long long>(
+                      fnv1a_hash(source.data(), source.size())));
+    return directory + "/" + name;
+}
+
+auto ProgramCache::get(const std::string_view &source) -> Program {
+    const auto source_hash = fnv1a_hash(source.data(), source.size());
+    const auto path = path_for(source);
+
+    Program program;
+    if (load_program(path, source_hash, source.size(), program)) {
+        hit_count++;
+        return program;
+    }
+
+    miss_count++;
+    program = compile(source);
+
+    // A cache that can't be written only costs the next run a compile
+    save_program(path, source_hash, source.size(), program);
+
+    return program;
+}
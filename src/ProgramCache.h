@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Program.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Cache of compiled programs in a directory, one file per source, named
+// after a hash of the source text. A hit maps the file and copies the code
+// and msg tables out in bulk, skipping lexing, parsing and verify(). Entries
+// that are stale (other format version, other source) or corrupt (bad size
+// or checksum) are compiled again and rewritten.
+class ProgramCache {
+  public:
+    explicit ProgramCache(std::string directory);
+
+    // Compiles the source, or loads it from the cache. Compile errors are
+    // thrown like compile() does and nothing is cached for them.
+    auto get(const std::string_view &source) -> Program;
+
+    auto hits() const noexcept -> size_t { return hit_count; }
+    auto misses() const noexcept -> size_t { return miss_count; }
+
+    // File the program compiled from source is cached in
+    auto path_for(const std::string_view &source) const -> std::string;
+
+  private:
+    std::string directory;
+    size_t hit_count = 0;
+    size_t miss_count = 0;
+};
+
+// FNV-1a, the hash cache entries are keyed and checksummed with
+auto fnv1a_hash(const void *data, const size_t &size,
+                std::uint64_t hash = 14695981039346656037ULL) noexcept
+    -> std::uint64_t;
+
+// Reads a cache file written by save_program() for a source of the given
+// hash and size. Returns false if it is missing, stale or corrupt.
+auto load_program(const std::string &path, const std::uint64_t &source_hash,
+                  const std::uint64_t &source_size, Program &program) -> bool;
+
+// Writes a cache file atomically: readers see the old file or the new one.
+// Returns false if it couldn't be written.
+auto save_program(const std::string &path, const std::uint64_t &source_hash,
+                  const std::uint64_t &source_size, const Program &program)
+    -> bool;
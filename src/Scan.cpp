@@ -0,0 +1,277 @@
+#include "Scan.h"
+
+#include <atomic>
+#include <initializer_list>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCAN_X86 1
+#include <immintrin.h>
+#else
+#define SCAN_X86 0
+#endif
+
+namespace {
+
+struct ScanFunctions {
+    ScanIsa isa;
+    auto (*byte)(const char *, const char *, char) -> const char *;
+    auto (*identifier)(const char *, const char *) -> const char *;
+    auto (*digits)(const char *, const char *) -> const char *;
+    auto (*blanks)(const char *, const char *) -> const char *;
+};
+
+constexpr auto is_identifier_char(const unsigned char c) -> bool {
+    return ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+            (c >= '0' && c <= '9') || c == '_');
+}
+
+constexpr auto is_digit(const unsigned char c) -> bool {
+    return c >= '0' && c <= '9';
+}
+
+constexpr auto is_blank(const unsigned char c) -> bool {
+    return c == ' ' || c == '\t';
+}
+
+// Scalar
+
+auto scalar_byte(const char *first, const char *last, char c)
+    -> const char * {
+    while (first != last && *first != c) {
+        first++;
+    }
+    return first;
+}
+
+auto scalar_identifier(const char *first, const char *last) -> const char * {
+    while (first != last && is_identifier_char(*first)) {
+        first++;
+    }
+    return first;
+}
+
+auto scalar_digits(const char *first, const char *last) -> const char * {
+    while (first != last && is_digit(*first)) {
+        first++;
+    }
+    return first;
+}
+
+auto scalar_blanks(const char *first, const char *last) -> const char * {
+    while (first != last && is_blank(*first)) {
+        first++;
+    }
+    return first;
+}
+
+constexpr ScanFunctions scalar_functions{ScanIsa::SCALAR, scalar_byte,
+                                         scalar_identifier, scalar_digits,
+                                         scalar_blanks};
+
+#if SCAN_X86
+
+// Byte classes are computed as masks with 0xFF in every matching lane. An
+// unsigned range check lo <= v <= hi is done as min(v - lo, hi - lo) ==
+// v - lo, since SSE2 and AVX2 only compare signed bytes.
+
+// SSE2, 16 bytes at a time
+
+#define SSE2 __attribute__((target("sse2")))
+
+SSE2 inline auto sse2_in_range(const __m128i &v, const char &lo,
+                               const char &hi) -> __m128i {
+    const __m128i offset = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8(hi - lo)),
+                          offset);
+}
+
+SSE2 inline auto sse2_identifier_mask(const __m128i &v) -> __m128i {
+    const __m128i letter = sse2_in_range(_mm_or_si128(v, _mm_set1_epi8(0x20)),
+                                         'a', 'z');
+    return _mm_or_si128(_mm_or_si128(letter, sse2_in_range(v, '0', '9')),
+                        _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+}
+
+SSE2 inline auto sse2_load(const char *p) -> __m128i {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+
+// Position of the first lane whose bit in mask is set, if any
+#define SSE2_SCAN(mask_expr, scalar_tail)                                      \
+    for (; last - first >= 16; first += 16) {                                  \
+        const __m128i v = sse2_load(first);                                    \
+        if (const unsigned mask = (mask_expr) & 0xFFFFU; mask != 0) {          \
+            return first + __builtin_ctz(mask);                                \
+        }                                                                      \
+    }                                                                          \
+    return scalar_tail
+
+SSE2 auto sse2_byte(const char *first, const char *last, char c)
+    -> const char * {
+    const __m128i needle = _mm_set1_epi8(c);
+    SSE2_SCAN(_mm_movemask_epi8(_mm_cmpeq_epi8(v, needle)),
+              scalar_byte(first, last, c));
+}
+
+SSE2 auto sse2_identifier(const char *first, const char *last)
+    -> const char * {
+    SSE2_SCAN(~_mm_movemask_epi8(sse2_identifier_mask(v)),
+              scalar_identifier(first, last));
+}
+
+SSE2 auto sse2_digits(const char *first, const char *last) -> const char * {
+    SSE2_SCAN(~_mm_movemask_epi8(sse2_in_range(v, '0', '9')),
+              scalar_digits(first, last));
+}
+
+SSE2 auto sse2_blanks(const char *first, const char *last) -> const char * {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    SSE2_SCAN(~_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, space),
+                                              _mm_cmpeq_epi8(v, tab))),
+              scalar_blanks(first, last));
+}
+
+#undef SSE2_SCAN
+#undef SSE2
+
+constexpr ScanFunctions sse2_functions{ScanIsa::SSE2, sse2_byte,
+                                       sse2_identifier, sse2_digits,
+                                       sse2_blanks};
+
+// AVX2, 32 bytes at a time
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 inline auto avx2_in_range(const __m256i &v, const char &lo,
+                               const char &hi) -> __m256i {
+    const __m256i offset = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+    return _mm256_cmpeq_epi8(
+        _mm256_min_epu8(offset, _mm256_set1_epi8(hi - lo)), offset);
+}
+
+AVX2 inline auto avx2_identifier_mask(const __m256i &v) -> __m256i {
+    const __m256i letter = avx2_in_range(
+        _mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 'z');
+    return _mm256_or_si256(
+        _mm256_or_si256(letter, avx2_in_range(v, '0', '9')),
+        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+}
+
+AVX2 inline auto avx2_load(const char *p) -> __m256i {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+}
+
+#define AVX2_SCAN(mask_expr, sse2_tail)                                        \
+    for (; last - first >= 32; first += 32) {                                  \
+        const __m256i v = avx2_load(first);                                    \
+        if (const auto mask = static_cast<unsigned>(mask_expr); mask != 0) {   \
+            return first + __builtin_ctz(mask);                                \
+        }                                                                      \
+    }                                                                          \
+    return sse2_tail
+
+AVX2 auto avx2_byte(const char *first, const char *last, char c)
+    -> const char * {
+    const __m256i needle = _mm256_set1_epi8(c);
+    AVX2_SCAN(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, needle)),
+              sse2_byte(first, last, c));
+}
+
+AVX2 auto avx2_identifier(const char *first, const char *last)
+    -> const char * {
+    AVX2_SCAN(~_mm256_movemask_epi8(avx2_identifier_mask(v)),
+              sse2_identifier(first, last));
+}
+
+AVX2 auto avx2_digits(const char *first, const char *last) -> const char * {
+    AVX2_SCAN(~_mm256_movemask_epi8(avx2_in_range(v, '0', '9')),
+              sse2_digits(first, last));
+}
+
+AVX2 auto avx2_blanks(const char *first, const char *last) -> const char * {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    AVX2_SCAN(~_mm256_movemask_epi8(_mm256_or_si256(
+                  _mm256_cmpeq_epi8(v, space), _mm256_cmpeq_epi8(v, tab))),
+              sse2_blanks(first, last));
+}
+
+#undef AVX2_SCAN
+#undef AVX2
+
+constexpr ScanFunctions avx2_functions{ScanIsa::AVX2, avx2_byte,
+                                       avx2_identifier, avx2_digits,
+                                       avx2_blanks};
+
+#endif
+
+auto functions_for(const ScanIsa &isa) -> const ScanFunctions * {
+#if SCAN_X86
+    __builtin_cpu_init(); // May run before the constructors, from detect()
+#endif
+
+    switch (isa) {
+#if SCAN_X86
+    case ScanIsa::AVX2:
+        return __builtin_cpu_supports("avx2") ? &avx2_functions : nullptr;
+    case ScanIsa::SSE2:
+        return __builtin_cpu_supports("sse2") ? &sse2_functions : nullptr;
+#else
+    case ScanIsa::AVX2:
+    case ScanIsa::SSE2:
+        return nullptr;
+#endif
+    case ScanIsa::SCALAR:
+        break;
+    }
+
+    return &scalar_functions;
+}
+
+auto detect() -> const ScanFunctions * {
+    for (const auto isa : {ScanIsa::AVX2, ScanIsa::SSE2}) {
+        if (const auto *functions = functions_for(isa)) {
+            return functions;
+        }
+    }
+    return &scalar_functions;
+}
+
+std::atomic<const ScanFunctions *> active{detect()};
+
+} // namespace
+
+auto best_scan_isa() noexcept -> ScanIsa { return detect()->isa; }
+
+auto scan_isa() noexcept -> ScanIsa {
+    return active.load(std::memory_order_relaxed)->isa;
+}
+
+auto set_scan_isa(const ScanIsa &isa) noexcept -> bool {
+    if (const auto *functions = functions_for(isa)) {
+        active.store(functions, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+auto scan_byte(const char *first, const char *last, const char &c) noexcept
+    -> const char * {
+    return active.load(std::memory_order_relaxed)->byte(first, last, c);
+}
+
+auto scan_identifier(const char *first, const char *last) noexcept
+    -> const char * {
+    return active.load(std::memory_order_relaxed)->identifier(first, last);
+}
+
+auto scan_digits(const char *first, const char *last) noexcept
+    -> const char * {
+    return active.load(std::memory_order_relaxed)->digits(first, last);
+}
+
+auto scan_blanks(const char *first, const char *last) noexcept
+    -> const char * {
+    return active.load(std::memory_order_relaxed)->blanks(first, last);
+}
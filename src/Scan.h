@@ -0,0 +1,34 @@
+#pragma once
+
+// Byte scanning primitives behind the lexer. Each one returns the first
+// position in [first, last) that stops the scan, or last. On x86 they look
+// at 16 (SSE2) or 32 (AVX2) bytes at a time, picked at run time from what
+// the CPU supports; elsewhere they fall back to scalar loops.
+
+enum class ScanIsa { SCALAR, SSE2, AVX2 };
+
+// Best implementation the running CPU supports
+auto best_scan_isa() noexcept -> ScanIsa;
+
+// The implementation in use, best_scan_isa() unless changed below
+auto scan_isa() noexcept -> ScanIsa;
+
+// Switches implementation, for benchmarks and testing. Returns false, and
+// changes nothing, if the CPU doesn't support it. Must not race with lexing.
+auto set_scan_isa(const ScanIsa &isa) noexcept -> bool;
+
+// First byte equal to c
+auto scan_byte(const char *first, const char *last, const char &c) noexcept
+    -> const char *;
+
+// First byte that can't continue an identifier: not [A-Za-z0-9_]
+auto scan_identifier(const char *first, const char *last) noexcept
+    -> const char *;
+
+// First byte that isn't a decimal digit
+auto scan_digits(const char *first, const char *last) noexcept
+    -> const char *;
+
+// First byte that isn't a space or a tab
+auto scan_blanks(const char *first, const char *last) noexcept
+    -> const char *;
@@ -0,0 +1,157 @@
+#include "Scheduler.h"
+
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+
+Scheduler::Scheduler(size_t thread_count, std::uint64_t time_slice)
+    : time_slice(std::max<std::uint64_t>(1, time_slice)) {
+    if (thread_count == 0) {
+        thread_count = std::max(1U, std::thread::hardware_concurrency());
+    }
+
+    for (size_t i = 0; i < thread_count; i++) {
+        threads.emplace_back([this] { worker_loop(); });
+    }
+}
+
+Scheduler::~Scheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    work_available.notify_all();
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+auto Scheduler::spawn(std::shared_ptr<const Program> program,
+                      const std::vector<std::pair<std::string, int>> &seeds,
+                      const VmLimits &limits) -> VmId {
+    auto vm = std::make_shared<Vm>(std::move(program), limits);
+    for (const auto &[name, value] : seeds) {
+        vm->machine.set_register(name, value);
+    }
+
+    VmId id = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        id = next_id++;
+        vms.emplace(id, vm);
+        ready.push_back(std::move(vm));
+    }
+    work_available.notify_one();
+
+    return id;
+}
+
+auto Scheduler::find(const VmId &id) const -> const std::shared_ptr<Vm> & {
+    const auto it = vms.find(id);
+    if (it == vms.end()) {
+        throw std::out_of_range("Unknown VM " + std::to_string(id));
+    }
+    return it->second;
+}
+
+auto Scheduler::cancel(const VmId &id) -> bool {
+    std::lock_guard<std::mutex> lock(mutex);
+    Vm &vm = *find(id);
+
+    if (vm.result.status != VmStatus::RUNNABLE) {
+        return false;
+    }
+    if (vm.running) {
+        vm.cancelled = true; // Its worker finishes it after the slice
+    } else {
+        finish(vm, VmStatus::CANCELLED); // Skipped once dequeued
+    }
+    return true;
+}
+
+auto Scheduler::status(const VmId &id) const -> VmStatus {
+    std::lock_guard<std::mutex> lock(mutex);
+    return find(id)->result.status;
+}
+
+auto Scheduler::wait(const VmId &id) -> VmResult {
+    std::unique_lock<std::mutex> lock(mutex);
+    const auto vm = find(id);
+
+    finished.wait(lock,
+                  [&] { return vm->result.status != VmStatus::RUNNABLE; });
+
+    vms.erase(id);
+    return std::move(vm->result);
+}
+
+auto Scheduler::finish(Vm &vm, const VmStatus &status) -> void {
+    vm.result.status = status;
+    vm.result.output = vm.machine.output();
+    vm.result.executed = vm.machine.executed();
+    finished.notify_all();
+}
+
+auto Scheduler::worker_loop() -> void {
+    for (;;) {
+        std::shared_ptr<Vm> vm;
+        std::uint64_t budget = time_slice;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            work_available.wait(lock,
+                                [this] { return stopping || !ready.empty(); });
+            if (stopping) {
+                return;
+            }
+
+            vm = std::move(ready.front());
+            ready.pop_front();
+
+            if (vm->result.status != VmStatus::RUNNABLE) {
+                continue; // Cancelled while queued
+            }
+            if (std::chrono::steady_clock::now() >= vm->limits.deadline) {
+                finish(*vm, VmStatus::DEADLINE_EXCEEDED);
+                continue;
+            }
+            if (vm->limits.quota != 0) {
+                budget = std::min(budget, vm->limits.quota -
+                                              vm->machine.executed());
+            }
+            vm->running = true;
+        }
+
+        RunStatus run_status = RunStatus::SUSPENDED;
+        std::string error;
+        bool failed = false;
+        try {
+            run_status = vm->machine.run_for(budget);
+        } catch (const std::exception &e) {
+            error = e.what();
+            failed = true;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        vm->running = false;
+
+        if (failed) {
+            vm->result.error = std::move(error);
+            finish(*vm, VmStatus::FAILED);
+        } else if (run_status == RunStatus::ENDED) {
+            finish(*vm, VmStatus::ENDED);
+        } else if (run_status == RunStatus::HALTED) {
+            finish(*vm, VmStatus::HALTED);
+        } else if (vm->cancelled) {
+            finish(*vm, VmStatus::CANCELLED);
+        } else if (vm->limits.quota != 0 &&
+                   vm->machine.executed() >= vm->limits.quota) {
+            finish(*vm, VmStatus::QUOTA_EXCEEDED);
+        } else if (std::chrono::steady_clock::now() >= vm->limits.deadline) {
+            finish(*vm, VmStatus::DEADLINE_EXCEEDED);
+        } else {
+            ready.push_back(std::move(vm));
+            work_available.notify_one();
+        }
+    }
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "Machine.h"
+#include "Program.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+enum class VmStatus {
+    RUNNABLE,          // Waiting for a worker or running on one
+    ENDED,             // Reached 'end'
+    HALTED,            // Ran off its end, "-1" for assembler_interpreter
+    FAILED,            // Threw, see VmResult::error
+    QUOTA_EXCEEDED,    // Ran every instruction of its quota
+    DEADLINE_EXCEEDED, // Still running at its deadline
+    CANCELLED
+};
+
+struct VmLimits {
+    std::uint64_t quota = 0; // Instructions it may run, 0 for no limit
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::time_point::max();
+};
+
+struct VmResult {
+    VmStatus status = VmStatus::RUNNABLE;
+    std::string output; // What it wrote, up to where it stopped
+    std::string error;  // What it threw, if FAILED
+    std::uint64_t executed = 0;
+};
+
+// Runs any number of programs concurrently on a fixed set of worker
+// threads. Workers take runnable VMs round robin from a shared queue and
+// run each for a time slice of instructions before putting it back, so a
+// program that never ends only ever holds one worker for one slice at a
+// time. Quotas are exact up to a fused instruction sequence, deadlines and
+// cancellation take effect between slices.
+class Scheduler {
+  public:
+    using VmId = std::uint64_t;
+
+    // Zero threads means one per hardware thread
+    explicit Scheduler(size_t threads = 0,
+                       std::uint64_t time_slice = 10000);
+    // Stops the workers once their current slices are over, VMs still
+    // runnable are dropped.
+    ~Scheduler();
+
+    Scheduler(const Scheduler &) = delete;
+    auto operator=(const Scheduler &) -> Scheduler & = delete;
+
+    // Queues a run of program with registers seeded, from its first
+    // instruction
+    auto spawn(std::shared_ptr<const Program> program,
+               const std::vector<std::pair<std::string, int>> &seeds = {},
+               const VmLimits &limits = {}) -> VmId;
+
+    // Stops a VM, at the end of its slice if it is running. Returns false
+    // if it has finished already.
+    auto cancel(const VmId &id) -> bool;
+
+    // Throws std::out_of_range for VMs unknown or already waited for
+    auto status(const VmId &id) const -> VmStatus;
+
+    // Blocks until the VM has finished, then forgets it
+    auto wait(const VmId &id) -> VmResult;
+
+    auto size() const noexcept -> size_t { return threads.size(); }
+
+  private:
+    struct Vm {
+        Vm(std::shared_ptr<const Program> program, const VmLimits &limits)
+            : program(std::move(program)), machine(*this->program),
+              limits(limits) {}
+
+        std::shared_ptr<const Program> program;
+        Machine machine;
+        VmLimits limits;
+        VmResult result;
+        bool running = false; // Owned by a worker, outside of the lock
+        bool cancelled = false;
+    };
+
+    auto worker_loop() -> void;
+    auto find(const VmId &id) const -> const std::shared_ptr<Vm> &;
+    auto finish(Vm &vm, const VmStatus &status) -> void;
+
+    std::uint64_t time_slice;
+    std::vector<std::thread> threads;
+
+    mutable std::mutex mutex; // Guards everything below and every Vm
+    std::condition_variable work_available;
+    std::condition_variable finished;
+    std::unordered_map<VmId, std::shared_ptr<Vm>> vms;
+    std::deque<std::shared_ptr<Vm>> ready;
+    VmId next_id = 0;
+    bool stopping = false;
+};
@@ -0,0 +1,109 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <utility>
+
+// Index of the pool worker running on this thread, if any
+static thread_local const ThreadPool *current_pool = nullptr;
+static thread_local size_t current_worker = 0;
+
+ThreadPool::ThreadPool(size_t thread_count) {
+    if (thread_count == 0) {
+        thread_count = std::max(1U, std::thread::hardware_concurrency());
+    }
+
+    for (size_t i = 0; i < thread_count; i++) {
+        queues.push_back(std::make_unique<TaskQueue>());
+    }
+
+    for (size_t i = 0; i < thread_count; i++) {
+        threads.emplace_back([this, i] { worker_loop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    work_available.notify_all();
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+auto ThreadPool::submit(std::function<void()> task) -> void {
+    const size_t index = current_pool == this
+                             ? current_worker
+                             : next_queue++ % queues.size();
+
+    pending++;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        {
+            std::lock_guard<std::mutex> queue_lock(queues[index]->mutex);
+            queues[index]->tasks.push_back(std::move(task));
+        }
+        queued++;
+    }
+    work_available.notify_one();
+}
+
+auto ThreadPool::wait() -> void {
+    std::unique_lock<std::mutex> lock(mutex);
+    all_done.wait(lock, [this] { return pending == 0; });
+}
+
+auto ThreadPool::take(const size_t &index, std::function<void()> &task)
+    -> bool {
+    { // Own tasks, newest first
+        auto &own = *queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            queued--;
+            return true;
+        }
+    }
+
+    // Steal the oldest task of another worker
+    for (size_t i = 1; i < queues.size(); i++) {
+        auto &victim = *queues[(index + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            queued--;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+auto ThreadPool::worker_loop(const size_t &index) -> void {
+    current_pool = this;
+    current_worker = index;
+
+    for (;;) {
+        std::function<void()> task;
+
+        if (take(index, task)) {
+            task();
+
+            if (--pending == 0) {
+                std::lock_guard<std::mutex> lock(mutex);
+                all_done.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        work_available.wait(lock, [this] { return stopping || queued > 0; });
+        if (stopping && queued == 0) {
+            return;
+        }
+    }
+}
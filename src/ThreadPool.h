@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed size work-stealing thread pool. Every worker owns a task deque: it
+// takes its own tasks newest first and, once out of work, steals the oldest
+// tasks of the other workers. Tasks must not throw.
+class ThreadPool {
+  public:
+    // Zero threads means one per hardware thread
+    explicit ThreadPool(size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    auto operator=(const ThreadPool &) -> ThreadPool & = delete;
+
+    // Tasks submitted from a worker go to its own deque, others are spread
+    // round robin.
+    auto submit(std::function<void()> task) -> void;
+
+    // Blocks until every submitted task has finished. Not for use from
+    // inside a task.
+    auto wait() -> void;
+
+    auto size() const noexcept -> size_t { return threads.size(); }
+
+  private:
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    auto worker_loop(const size_t &index) -> void;
+    auto take(const size_t &index, std::function<void()> &task) -> bool;
+
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex mutex; // Guards sleeping and waking, not the queues
+    std::condition_variable work_available;
+    std::condition_variable all_done;
+    std::atomic<size_t> queued{0};  // Tasks sitting in a queue
+    std::atomic<size_t> pending{0}; // Tasks submitted but not finished
+    std::atomic<size_t> next_queue{0};
+    bool stopping = false;
+};
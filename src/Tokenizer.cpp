@@ -1,4 +1,5 @@
 #include "Errors.h"
+#include "Scan.h"
 #include "Tokenizer.h"
 
 constexpr auto is_potential_identifier_start(const unsigned char c) -> bool {
@@ -10,52 +11,84 @@ constexpr auto is_potential_identifier_char(const unsigned char c) -> bool {
             (c >= '0' && c <= '9') || c == '_');
 }
 
-auto tokenizer(const std::string_view &line, const unsigned int &lineno)
-    -> std::vector<Token> {
-    std::vector<Token> tokens;
+auto tokenize(const std::string_view &line, const unsigned int &lineno,
+              std::vector<Token> &tokens, Diagnostic &diagnostic) -> bool {
+    const char *const line_end = line.data() + line.size();
+    const auto column = [&](const char *position) {
+        return static_cast<unsigned int>(position - line.data() + 1);
+    };
 
-    for (std::string_view::const_iterator it = line.begin(); it != line.end();
-         it++) {
+    for (const char *it = line.data(); it != line_end; it++) {
         char c = *it;
 
         if (is_potential_identifier_start(c)) { // Parse identifier
-            std::string_view::const_iterator search = std::find_if_not(
-                std::next(it), line.end(), is_potential_identifier_char);
+            const char *search = scan_identifier(it + 1, line_end);
 
             tokens.emplace_back(TokenType::IDENTIFIER,
-                                line.substr(it - line.begin(), search - it));
-            it = std::prev(search);
+                                std::string_view(it, search - it));
+            it = search - 1;
         } else if (static_cast<bool>(isdigit(c)) || (c == '+') ||
                    (c == '-')) { // Parse Numbers
-            std::string_view::const_iterator search =
-                std::find_if_not(std::next(it), line.end(), isdigit);
+            const char *search = scan_digits(it + 1, line_end);
             tokens.emplace_back(TokenType::NUMBER,
-                                line.substr(it - line.begin(), search - it));
-            it = std::prev(search);
+                                std::string_view(it, search - it));
+            it = search - 1;
         } else if (c == '\'') { // Parse string
-            std::string_view::const_iterator search =
-                std::find_if(std::next(it), line.end(),
-                             [](unsigned char c) { return c == '\''; });
-            if (search != line.end()) {
-                tokens.emplace_back(
-                    TokenType::STRING,
-                    line.substr(it + 1 - line.begin(), search - it - 1));
+            const char *search = scan_byte(it + 1, line_end, '\'');
+            if (search != line_end) {
+                tokens.emplace_back(TokenType::STRING,
+                                    std::string_view(it + 1, search - it - 1));
                 it = search; // search can't be the end here.
             } else {
-                PARSE_ERR(lineno, "Unmatched \"'\"");
+                return report(diagnostic, lineno, column(it),
+                              DiagnosticCode::UNMATCHED_QUOTE,
+                              "Unmatched \"'\"");
             }
         } else if (static_cast<bool>(isblank(c))) { // Parse whitespace
-            continue;
+            it = scan_blanks(it + 1, line_end) - 1;
         } else if (c == ',') { // Parse coma
-            tokens.emplace_back(TokenType::COMA, ",");
+            tokens.emplace_back(TokenType::COMA, std::string_view(it, 1));
         } else if (c == ':') { // Parse colon
-            tokens.emplace_back(TokenType::COLON, ":");
-        } else if (c == ';') { // Parse semicolon
-            break;
+            tokens.emplace_back(TokenType::COLON, std::string_view(it, 1));
+        } else if (c == ';') { // Parse semicolon, the newline scan skipped
+            break;             // the rest of the line already
         } else {
-            PARSE_ERR(lineno, "Unknown token passed: '" + c + "'");
+            return report(diagnostic, lineno, column(it),
+                          DiagnosticCode::UNKNOWN_TOKEN,
+                          std::string("Unknown token passed: '") + c + "'");
         }
     }
 
+    return true;
+}
+
+auto tokenizer(const std::string_view &line, const unsigned int &lineno,
+               std::vector<Token> &tokens) -> void {
+    if (Diagnostic diagnostic; !tokenize(line, lineno, tokens, diagnostic)) {
+        PARSE_ERR(lineno, diagnostic.message);
+    }
+}
+
+auto tokenizer(const std::string_view &line, const unsigned int &lineno)
+    -> std::vector<Token> {
+    std::vector<Token> tokens;
+    tokenizer(line, lineno, tokens);
     return tokens;
 }
+
+auto Lexer::next_line(std::vector<Token> &tokens) -> bool {
+    tokens.clear();
+
+    while (tokens.empty() && position < source.size()) {
+        const char *const first = source.data() + position;
+        const size_t line_end =
+            scan_byte(first, source.data() + source.size(), '\n') -
+            source.data();
+
+        line++;
+        tokenizer(source.substr(position, line_end - position), line, tokens);
+        position = line_end + 1;
+    }
+
+    return !tokens.empty();
+}
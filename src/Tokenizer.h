@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Diagnostic.h"
+
 #include <algorithm>
 #include <string>
 #include <string_view>
@@ -28,3 +30,33 @@ struct Token {
 
 auto tokenizer(const std::string_view &line, const unsigned int &lineno)
     -> std::vector<Token>;
+
+// Same as above, but appends to 'tokens' instead of a new vector
+auto tokenizer(const std::string_view &line, const unsigned int &lineno,
+               std::vector<Token> &tokens) -> void;
+
+// Same as above, but returns false with the error in diagnostic instead of
+// throwing. Tokens before the error are appended all the same.
+auto tokenize(const std::string_view &line, const unsigned int &lineno,
+              std::vector<Token> &tokens, Diagnostic &diagnostic) -> bool;
+
+// Walks a whole source buffer once, line by line. The caller's token buffer
+// is reused for every line, so once it has grown to the longest line lexing
+// doesn't allocate.
+class Lexer {
+  public:
+    explicit Lexer(const std::string_view &source) noexcept
+        : source(source) {}
+
+    // Replaces 'tokens' with the tokens of the next line that has any.
+    // Returns false once the source is exhausted.
+    auto next_line(std::vector<Token> &tokens) -> bool;
+
+    // Line number of the last line returned by next_line(), from 1
+    auto lineno() const noexcept -> unsigned int { return line; }
+
+  private:
+    std::string_view source;
+    size_t position = 0;
+    unsigned int line = 0;
+};
@@ -0,0 +1,352 @@
+#include "Verifier.h"
+#include "Optimizer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace {
+
+using Word = std::uint64_t;
+
+constexpr std::uint32_t NONE = UINT32_MAX;
+
+// Limits in words of register sets: of them stored, and of them gone
+// through before giving up, a few hundred milliseconds at most
+constexpr size_t state_limit = size_t(1) << 21;
+constexpr size_t work_limit = size_t(1) << 27;
+
+// Forward analysis of the registers defined on every path to each basic
+// block. A superinstruction is taken as its first instruction, which the
+// code after it completes.
+class Analysis {
+  public:
+    explicit Analysis(const Program &program);
+
+    // Summarizes every subroutine, then analyzes the whole program.
+    // Returns false if it gave up.
+    auto run() -> bool;
+
+    // Checks instruction index still needs, run() having succeeded
+    auto checks(const size_t &index) const -> std::uint8_t {
+        return op_checks[index];
+    }
+
+  private:
+    // The registers defined on entry to every block reached from first,
+    // with none defined there, and at every 'ret' reached into returned.
+    // Calls are followed into their subroutine if enter is set, stepped
+    // over by its summary either way.
+    auto flow(const size_t &first, const bool &enter) -> void;
+
+    // Goes through a block from the registers defined on its entry, into
+    // the blocks after it. visit(index, op) sees each instruction before
+    // it runs, with the registers then defined in cur.
+    template <typename Visit>
+    auto walk(const std::uint32_t &block, const bool &enter, Visit visit)
+        -> void;
+
+    auto merge(const size_t &index) -> void;
+
+    auto state(const std::uint32_t &block) -> Word * {
+        return states.data() + block * words;
+    }
+    auto summary(const size_t &target) -> Word * {
+        return summaries.data() + routine_at[target] * words;
+    }
+    auto defined(const OperandKind &kind, const std::int32_t &slot) const
+        -> bool {
+        return kind != OperandKind::REG || (cur[slot / 64] >> slot % 64) & 1;
+    }
+    auto define(const OperandKind &kind, const std::int32_t &slot) -> void {
+        if (kind == OperandKind::REG) {
+            cur[slot / 64] |= Word(1) << slot % 64;
+        }
+    }
+
+    const Program &program;
+    const std::vector<Op> &code;
+    const size_t words; // Per register set
+
+    std::vector<std::uint32_t> block_of; // Of the leader, NONE elsewhere
+    std::vector<size_t> starts;          // Leader of each block
+    std::vector<std::uint32_t> routine_at; // Of call targets, NONE elsewhere
+    std::vector<size_t> routines;          // Target of each subroutine
+
+    std::vector<Word> states;    // Per block
+    std::vector<Word> summaries; // Per subroutine, defined by its 'ret's
+    std::vector<std::uint8_t> reached;
+    std::vector<std::uint8_t> queued;
+    std::vector<std::uint32_t> worklist;
+    std::vector<Word> cur;
+    std::vector<Word> returned;
+    bool returns = false;
+    size_t work = 0;
+
+    std::vector<std::uint8_t> op_checks;
+};
+
+Analysis::Analysis(const Program &program)
+    : program(program), code(program.code),
+      words((program.reg_names.size() + 63) / 64),
+      block_of(code.size(), NONE), routine_at(code.size(), NONE),
+      cur(words), returned(words), op_checks(code.size(), ALL_CHECKS) {
+    const auto leaders = find_leaders(program);
+
+    for (size_t i = 0; i < code.size(); i++) {
+        if (i == 0 || leaders[i]) {
+            block_of[i] = static_cast<std::uint32_t>(starts.size());
+            starts.push_back(i);
+        }
+        if (code[i].code == OpCode::CALL &&
+            routine_at[code[i].target] == NONE) {
+            routine_at[code[i].target] =
+                static_cast<std::uint32_t>(routines.size());
+            routines.push_back(code[i].target);
+        }
+    }
+}
+
+auto Analysis::merge(const size_t &index) -> void {
+    const auto block = block_of[index];
+    Word *const into = state(block);
+    bool changed = !reached[block];
+
+    if (changed) {
+        std::copy(cur.begin(), cur.end(), into);
+        reached[block] = true;
+    } else {
+        for (size_t w = 0; w < words; w++) {
+            changed |= (into[w] & cur[w]) != into[w];
+            into[w] &= cur[w];
+        }
+    }
+
+    if (changed && !queued[block]) {
+        queued[block] = true;
+        worklist.push_back(block);
+    }
+}
+
+template <typename Visit>
+auto Analysis::walk(const std::uint32_t &block, const bool &enter,
+                    Visit visit) -> void {
+    const size_t end =
+        block + 1 < starts.size() ? starts[block + 1] : code.size();
+    work += (end - starts[block]) * words;
+    std::copy_n(state(block), words, cur.begin());
+
+    for (size_t i = starts[block];; i++) {
+        const Op &op = code[i];
+        visit(i, op);
+
+        switch (op.code) {
+        case OpCode::JMP:
+            merge(op.target);
+            return;
+
+        case OpCode::JNE:
+        case OpCode::JE:
+        case OpCode::JGE:
+        case OpCode::JG:
+        case OpCode::JLE:
+        case OpCode::JL:
+            merge(op.target);
+            break;
+
+        case OpCode::CALL: {
+            if (enter) {
+                merge(op.target);
+            }
+            const Word *const defines = summary(op.target);
+            for (size_t w = 0; w < words; w++) {
+                cur[w] |= defines[w];
+            }
+            break;
+        }
+
+        case OpCode::RET:
+            if (returns) {
+                for (size_t w = 0; w < words; w++) {
+                    returned[w] &= cur[w];
+                }
+            } else {
+                returned = cur;
+                returns = true;
+            }
+            return;
+
+        case OpCode::END:
+        case OpCode::HALT:
+        case OpCode::INVALID_INTEGER:
+            return;
+
+        case OpCode::MSG: {
+            const auto first = program.msg_args.begin() + op.target;
+            for (auto arg = first; arg != first + op.a; arg++) {
+                define(arg->kind, arg->value);
+            }
+            break;
+        }
+
+        case OpCode::CLOSED_LOOP:
+            merge(program.loops[op.target].exit);
+            break;
+
+        case OpCode::INC: // A superinstruction's b is for the cmp after it
+        case OpCode::DEC:
+        case OpCode::INC_CMP_JNE:
+        case OpCode::INC_CMP_JE:
+        case OpCode::INC_CMP_JGE:
+        case OpCode::INC_CMP_JG:
+        case OpCode::INC_CMP_JLE:
+        case OpCode::INC_CMP_JL:
+        case OpCode::DEC_CMP_JNE:
+        case OpCode::DEC_CMP_JE:
+        case OpCode::DEC_CMP_JGE:
+        case OpCode::DEC_CMP_JG:
+        case OpCode::DEC_CMP_JLE:
+        case OpCode::DEC_CMP_JL:
+            define(op.a_kind, op.a);
+            break;
+
+        default: // Reads or writes a, reads b, like a fused cmp
+            define(op.a_kind, op.a);
+            define(op.b_kind, op.b);
+            break;
+        }
+
+        if (block_of[i + 1] != NONE) {
+            merge(i + 1);
+            return;
+        }
+    }
+}
+
+auto Analysis::flow(const size_t &first, const bool &enter) -> void {
+    std::fill(reached.begin(), reached.end(), 0);
+    std::fill(queued.begin(), queued.end(), 0);
+    worklist.clear();
+    returns = false;
+    work += starts.size() / 8;
+
+    std::fill(cur.begin(), cur.end(), 0);
+    merge(first);
+
+    while (!worklist.empty() && work < work_limit) {
+        const auto block = worklist.back();
+        worklist.pop_back();
+        queued[block] = false;
+        walk(block, enter, [](const size_t &, const Op &) {});
+    }
+}
+
+auto Analysis::run() -> bool {
+    if (starts.size() * words > state_limit ||
+        routines.size() * words > state_limit) {
+        return false;
+    }
+    states.resize(starts.size() * words);
+    reached.resize(starts.size());
+    queued.resize(starts.size());
+
+    // Summaries start from every register and shrink to what every 'ret'
+    // of a subroutine, and of those it calls, has defined. One that never
+    // returns keeps every register, its call is never left anyway.
+    summaries.assign(routines.size() * words, ~Word(0));
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (const auto target : routines) {
+            flow(target, false);
+            if (!returns) {
+                returned.assign(words, ~Word(0));
+            }
+            if (!std::equal(returned.begin(), returned.end(),
+                            summary(target))) {
+                std::copy(returned.begin(), returned.end(), summary(target));
+                changed = true;
+            }
+        }
+        if (work >= work_limit) {
+            return false;
+        }
+    }
+
+    // A 'ret' the first instruction reaches without a call can run on an
+    // empty stack. Without calls, that is every 'ret' reached.
+    std::vector<std::uint8_t> outside_calls;
+    if (!routines.empty()) {
+        flow(0, false);
+        outside_calls = reached;
+    }
+    flow(0, true);
+    if (routines.empty()) {
+        outside_calls = reached;
+    }
+    if (work >= work_limit) {
+        return false;
+    }
+
+    for (std::uint32_t block = 0; block < starts.size(); block++) {
+        if (!reached[block]) {
+            continue; // Never runs, keeps every check
+        }
+
+        walk(block, true, [&](const size_t &index, const Op &op) {
+            std::uint8_t needed = 0;
+
+            if (op.code != OpCode::MOV && !defined(op.a_kind, op.a)) {
+                needed |= CHECK_A;
+            }
+            if (!defined(op.b_kind, op.b)) {
+                needed |= CHECK_B;
+            }
+
+            switch (op.code) {
+            case OpCode::DIV:
+                if (op.b_kind != OperandKind::IMM || op.b == 0) {
+                    needed |= CHECK_DIVISOR;
+                }
+                break;
+
+            case OpCode::RET:
+                if (outside_calls[block]) {
+                    needed |= CHECK_STACK;
+                }
+                break;
+
+            case OpCode::MSG:
+            case OpCode::INVALID_INTEGER: {
+                const auto first = program.msg_args.begin() + op.target;
+                for (auto arg = first; arg != first + op.a; arg++) {
+                    if (!defined(arg->kind, arg->value)) {
+                        needed |= CHECK_A;
+                    }
+                }
+                break;
+            }
+
+            default:
+                break;
+            }
+
+            op_checks[index] = needed;
+        });
+    }
+
+    return true;
+}
+
+} // namespace
+
+auto verify(Program &program) -> bool {
+    Analysis analysis(program);
+    program.verified = analysis.run();
+
+    for (size_t i = 0; i < program.code.size(); i++) {
+        program.code[i].checks =
+            program.verified ? analysis.checks(i) : std::uint8_t{ALL_CHECKS};
+    }
+
+    return program.verified;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "Program.h"
+
+// Proves which run time checks of a finished program always pass, and
+// clears them from its Op::checks:
+//  - a register read is defined if every path to the read defines it, by
+//    'mov' or by a read before, which would have ended the run otherwise.
+//    Calls define what their subroutine defines on every path to a 'ret'.
+//    Seeding only defines more registers, so this holds for any seeding.
+//  - 'div' by an immediate other than 0.
+//  - 'ret' that only runs inside a call.
+// Runs after fuse_superinstructions(). Gives up on programs too large to
+// analyze quickly, keeping every check. Returns whether it didn't, which
+// Program::verified records.
+auto verify(Program &program) -> bool;
@@ -0,0 +1,76 @@
+// Checks that the random programs AsmInterpTestPrograms generated, as
+// translated ahead of time to C++ with every optimization, give what the
+// interpreter gives on their unoptimized source: the same output or "-1",
+// or the same error.
+// Usage: AsmInterpAotTest <directory of the sources>
+
+#include "Compiler.h"
+#include "Machine.h"
+
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+#define PROGRAM(function) auto function() -> std::string;
+#include "random_programs.inc"
+#undef PROGRAM
+
+namespace {
+
+struct Translated {
+    const char *name;
+    std::string (*function)();
+};
+
+#define PROGRAM(function) {#function, function},
+const Translated programs[] = {
+#include "random_programs.inc"
+};
+#undef PROGRAM
+
+// What the run gave, or "error: " and what it threw
+template <typename Run> auto outcome(Run run) -> std::string {
+    try {
+        return run();
+    } catch (const std::exception &e) {
+        return std::string("error: ") + e.what();
+    }
+}
+
+} // namespace
+
+auto main(int argc, char **argv) -> int {
+    if (argc != 2) {
+        std::fprintf(stderr, "usage: %s <directory>\n", argv[0]);
+        return 2;
+    }
+
+    int mismatches = 0;
+    for (const auto &[name, function] : programs) {
+        std::ifstream file(std::string(argv[1]) + "/" + name + ".asm");
+        std::stringstream source;
+        source << file.rdbuf();
+
+        const auto interpreted = outcome([&] {
+            const Program program = compile(source.str());
+            Machine machine(program);
+            machine.run();
+            return machine.result();
+        });
+        const auto translated = outcome(function);
+
+        if (!file || interpreted != translated) {
+            std::fprintf(stderr, "%s: results differ\n  interpreter: %s\n"
+                                 "  translated:  %s\n",
+                         name, interpreted.c_str(), translated.c_str());
+            mismatches++;
+        }
+    }
+
+    std::printf("%zu programs, %d mismatches\n", std::size(programs),
+                mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
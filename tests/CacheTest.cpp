@@ -0,0 +1,141 @@
+// Saves random programs, optimized and not, to a cache file and checks that
+// each loads back as it was, run time checks included, and that files whose
+// fields were changed to ones no engine can run, or that leave out checks
+// an engine can't do without, are rejected although their checksum is
+// right.
+// Usage: AsmInterpCacheTest <scratch directory>
+
+#include "Compiler.h"
+#include "ProgramCache.h"
+#include "ProgramGenerator.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace {
+
+constexpr std::uint64_t source_hash = 1;
+constexpr std::uint64_t source_size = 2;
+
+auto same(const Program &lhs, const Program &rhs) -> bool {
+    const auto same_bytes = [](const auto &left, const auto &right) {
+        using Value = typename std::decay_t<decltype(left)>::value_type;
+        return left.size() == right.size() &&
+               std::memcmp(left.data(), right.data(),
+                           left.size() * sizeof(Value)) == 0;
+    };
+
+    if (lhs.labels.size() != rhs.labels.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < lhs.labels.size(); i++) {
+        if (lhs.labels[i].name != rhs.labels[i].name ||
+            lhs.labels[i].target != rhs.labels[i].target) {
+            return false;
+        }
+    }
+
+    return same_bytes(lhs.code, rhs.code) &&
+           same_bytes(lhs.msg_args, rhs.msg_args) &&
+           lhs.strings == rhs.strings && lhs.reg_names == rhs.reg_names &&
+           same_bytes(lhs.loops, rhs.loops) &&
+           same_bytes(lhs.loop_updates, rhs.loop_updates) &&
+           same_bytes(lhs.pure_routines, rhs.pure_routines) &&
+           lhs.pure_slots == rhs.pure_slots && lhs.verified == rhs.verified;
+}
+
+// The first instruction of the program with the opcode
+auto first(Program &program, const OpCode &code) -> Op & {
+    for (auto &op : program.code) {
+        if (op.code == code) {
+            return op;
+        }
+    }
+    std::fprintf(stderr, "no such instruction\n");
+    std::exit(1);
+}
+
+} // namespace
+
+auto main(int argc, char **argv) -> int {
+    if (argc != 2) {
+        std::fprintf(stderr, "usage: %s <scratch directory>\n", argv[0]);
+        return 2;
+    }
+
+    const std::string path = std::string(argv[1]) + "/cache_test.asmc";
+    int failures = 0;
+
+    ProgramGenerator generator(1);
+    for (int i = 0; i < 500; i++) {
+        const auto source = generator.program();
+        for (const auto &passes : {OptimizerPasses{}, OptimizerPasses::all()}) {
+            const Program program = compile(source, passes);
+            Program loaded;
+            if (!save_program(path, source_hash, source_size, program) ||
+                !load_program(path, source_hash, source_size, loaded) ||
+                !same(program, loaded)) {
+                std::fprintf(stderr, "doesn't load back as saved:\n%s--\n",
+                             source.c_str());
+                failures++;
+            }
+        }
+    }
+
+    // Each makes the program read or write out of bounds, or divide by 0.
+    // The 'ret' is reached both inside the call and after it.
+    const Program program = compile("mov a, 1\nl:\ninc a\ncmp a, 5\njl l\n"
+                                    "call f\nf:\ndiv a, 2\nmsg 'a', a\nret\n",
+                                    OptimizerPasses::all());
+    const std::pair<const char *, std::function<void(Program &)>>
+        corruptions[] = {
+            {"immediate mov target",
+             [](Program &p) { p.code[0].a_kind = OperandKind::IMM; }},
+            {"string mov",
+             [](Program &p) {
+                 p.code[0].code = OpCode::MOV;
+                 p.code[0].b_kind = OperandKind::STR;
+             }},
+            {"operand kind",
+             [](Program &p) { p.code[0].b_kind = OperandKind{9}; }},
+            {"opcode", [](Program &p) { p.code[0].code = OpCode{200}; }},
+            {"msg argument kind",
+             [](Program &p) { p.msg_args[1].kind = OperandKind::NONE; }},
+            {"label", [](Program &p) { p.labels[0].target = 1000; }},
+            {"loop condition",
+             [](Program &p) { p.loops.at(0).condition = OpCode::MOV; }},
+            {"loop bound kind",
+             [](Program &p) { p.loops.at(0).bound_kind = OperandKind::STR; }},
+            {"loop update",
+             [](Program &p) { p.loop_updates.at(0).code = OpCode::MUL; }},
+            {"check", [](Program &p) { p.code[0].checks = 16; }},
+            {"divisor check",
+             [](Program &p) {
+                 Op &op = first(p, OpCode::DIV);
+                 op.b_kind = OperandKind::REG;
+                 op.b = 0;
+                 op.checks &= ~CHECK_DIVISOR;
+             }},
+            {"stack check",
+             [](Program &p) { first(p, OpCode::RET).checks &= ~CHECK_STACK; }},
+        };
+    for (const auto &[what, corrupt] : corruptions) {
+        Program corrupted = program;
+        corrupt(corrupted);
+        Program loaded;
+        if (!save_program(path, source_hash, source_size, corrupted) ||
+            load_program(path, source_hash, source_size, loaded)) {
+            std::fprintf(stderr, "loaded a program with a bad %s\n", what);
+            failures++;
+        }
+    }
+
+    std::remove(path.c_str());
+    std::printf("%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,209 @@
+// Runs random programs unoptimized on the switch engine, and checks that
+// every engine, with and without the optimizer, a rerun on the calls the
+// memo table recorded, a CompileSession edited into the same source,
+// try_compile(), and run_lanes() against run_batch() on seeded registers,
+// do exactly the same.
+// Usage: AsmInterpDifferentialTest [programs] [seed]
+
+#include "BatchExecutor.h"
+#include "CompileSession.h"
+#include "Compiler.h"
+#include "LaneExecutor.h"
+#include "Machine.h"
+#include "Outcome.h"
+#include "ProgramGenerator.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Instructions a program may run before it is taken for one that never
+// ends and skipped
+constexpr std::uint64_t budget = 1'000'000;
+
+// The outcome of a run on the switch engine, nothing if it runs past the
+// budget
+auto run_budgeted(const Program &program,
+                  const std::vector<std::pair<std::string, int>> &seeds = {})
+    -> std::optional<Outcome> {
+    Machine machine(program);
+    for (const auto &[name, value] : seeds) {
+        machine.set_register(name, value);
+    }
+
+    Outcome outcome;
+    try {
+        const auto status = machine.run_for(budget);
+        if (status == RunStatus::SUSPENDED) {
+            return std::nullopt;
+        }
+        outcome.ended = status == RunStatus::ENDED;
+    } catch (const std::exception &e) {
+        outcome.error = e.what();
+    }
+    outcome.output = machine.output();
+    return outcome;
+}
+
+class Checker {
+  public:
+    explicit Checker(const std::uint32_t &seed) : generator(seed) {}
+
+    // Checks the next random program, returns false if it was skipped
+    auto check() -> bool;
+
+    int mismatches = 0;
+    std::uint64_t memo_hits = 0;
+    long lane_seedings = 0;
+
+  private:
+    auto mismatch(const char *what, const std::string &expected,
+                  const std::string &actual) -> void;
+    auto check_lanes(const std::shared_ptr<const Program> &program) -> void;
+
+    ProgramGenerator generator;
+    std::string source;
+};
+
+auto Checker::mismatch(const char *what, const std::string &expected,
+                       const std::string &actual) -> void {
+    // The first few are enough to go on
+    if (mismatches++ < 5) {
+        std::fprintf(stderr,
+                     "%s differs on\n%s--\n  expected: %s\n  actual:   %s\n",
+                     what, source.c_str(), expected.c_str(), actual.c_str());
+    }
+}
+
+auto Checker::check() -> bool {
+    source = generator.program();
+
+    const Program plain = compile(source);
+    const auto expected = run_budgeted(plain);
+    if (!expected) {
+        return false;
+    }
+
+    static const std::pair<DispatchEngine, const char *> engines[] = {
+        {DispatchEngine::SWITCH, "switch"},
+        {DispatchEngine::THREADED, "threaded"},
+        {DispatchEngine::JIT, "jit"},
+    };
+
+    const auto optimized = std::make_shared<const Program>(
+        compile(source, OptimizerPasses::all()));
+    for (const auto &[engine, name] : engines) {
+        if (const auto outcome = run(plain, engine); outcome != *expected) {
+            mismatch(name, describe(*expected), describe(outcome));
+        }
+        if (const auto outcome = run(*optimized, engine);
+            outcome != *expected) {
+            mismatch((std::string("optimized ") + name).c_str(),
+                     describe(*expected), describe(outcome));
+        }
+    }
+
+    // Again on the same Machine, whose memo table kept the calls of pure
+    // subroutines the first run recorded
+    Machine machine(*optimized);
+    run(machine, DispatchEngine::SWITCH);
+    machine.reset();
+    if (const auto outcome = run(machine, DispatchEngine::THREADED);
+        outcome != *expected) {
+        mismatch("memoized rerun", describe(*expected), describe(outcome));
+    }
+    memo_hits += machine.memo_hits();
+
+    // Edited in over another program, whose registers keep their slots
+    CompileSession session(generator.program());
+    session.edit(1, session.line_count(), source);
+    if (const auto outcome = run_budgeted(session.program());
+        !outcome || *outcome != *expected) {
+        mismatch("session", describe(*expected),
+                 outcome ? describe(*outcome) : "past the budget");
+    }
+
+    // Numbers no int holds are only warnings
+    if (const auto tried = try_compile(source); !tried.program) {
+        mismatch("try_compile", describe(*expected),
+                 tried.diagnostics.at(0).message);
+    } else if (const auto outcome = run_budgeted(*tried.program);
+               !outcome || *outcome != *expected) {
+        mismatch("try_compile", describe(*expected),
+                 outcome ? describe(*outcome) : "past the budget");
+    }
+
+    check_lanes(optimized);
+    return true;
+}
+
+auto Checker::check_lanes(const std::shared_ptr<const Program> &program)
+    -> void {
+    std::vector<std::vector<std::pair<std::string, int>>> seeds(
+        1 + generator.pick(2 * lane_count));
+    std::vector<BatchJob> jobs(seeds.size());
+
+    for (size_t i = 0; i < seeds.size(); i++) {
+        for (const char *name : {"a", "b", "c", "d", "e", "i", "n", "zz"}) {
+            if (generator.pick(2) != 0) {
+                seeds[i].emplace_back(name, generator.seed_value());
+            }
+        }
+        if (!run_budgeted(*program, seeds[i])) {
+            return;
+        }
+        jobs[i].program = program;
+        jobs[i].seeds = seeds[i];
+    }
+
+    ThreadPool pool(1);
+    const auto batch = run_batch(jobs, pool);
+    const auto lanes = run_lanes(*program, seeds, pool);
+
+    for (size_t i = 0; i < seeds.size(); i++) {
+        const auto summary = [](const BatchResult &result) {
+            std::string text = (result.ok ? "[" : "failed [") +
+                               result.output + "] " + result.error + " {";
+            for (const auto &value : result.registers) {
+                text += value ? std::to_string(*value) + " " : "- ";
+            }
+            return text + "}";
+        };
+
+        if (batch[i].ok != lanes[i].ok || batch[i].output != lanes[i].output ||
+            batch[i].error != lanes[i].error ||
+            batch[i].registers != lanes[i].registers) {
+            mismatch(("lanes, seeding " + std::to_string(i)).c_str(),
+                     summary(batch[i]), summary(lanes[i]));
+        }
+    }
+    lane_seedings += static_cast<long>(seeds.size());
+}
+
+} // namespace
+
+auto main(int argc, char **argv) -> int {
+    const long count = argc > 1 ? std::atol(argv[1]) : 2000;
+    const auto seed =
+        static_cast<std::uint32_t>(argc > 2 ? std::atol(argv[2]) : 1);
+
+    Checker checker(seed);
+    long checked = 0;
+    for (long i = 0; i < count; i++) {
+        checked += checker.check() ? 1 : 0;
+    }
+
+    std::printf("%ld programs, %ld skipped as endless, %llu memo hits, "
+                "%ld lane seedings, %d mismatches\n",
+                count, count - checked,
+                static_cast<unsigned long long>(checker.memo_hits),
+                checker.lane_seedings, checker.mismatches);
+    return checker.mismatches == 0 ? 0 : 1;
+}
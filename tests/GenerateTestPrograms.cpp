@@ -0,0 +1,67 @@
+// Writes random programs for AsmInterpAotTest to translate at build time:
+// random<i>.asm, and random_programs.inc listing them as PROGRAM(random<i>).
+// Only programs that end within a budget are kept, as translated ones
+// can't be stopped.
+// Usage: AsmInterpTestPrograms <directory> <count>
+
+#include "Compiler.h"
+#include "Machine.h"
+#include "ProgramGenerator.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <string>
+
+static auto write_file(const std::string &path, const std::string &text)
+    -> bool {
+    std::ofstream file(path, std::ios::binary);
+    file << text;
+    return static_cast<bool>(file);
+}
+
+static auto ends(const std::string &source) -> bool {
+    const Program program = compile(source);
+    Machine machine(program);
+    try {
+        return machine.run_for(1'000'000) != RunStatus::SUSPENDED;
+    } catch (const std::exception &) {
+        return true; // Failing is ending too
+    }
+}
+
+auto main(int argc, char **argv) -> int {
+    if (argc != 3) {
+        std::fprintf(stderr, "usage: %s <directory> <count>\n", argv[0]);
+        return 2;
+    }
+
+    const std::string directory = argv[1];
+    const long count = std::atol(argv[2]);
+
+    ProgramGenerator generator(1);
+    std::string list =
+        "// Generated by AsmInterpTestPrograms, do not edit.\n"
+        "// The including file defines PROGRAM(function).\n";
+
+    for (long i = 0; i < count;) {
+        const auto source = generator.program();
+        if (!ends(source)) {
+            continue;
+        }
+
+        const auto function = "random" + std::to_string(i++);
+        if (!write_file(directory + "/" + function + ".asm", source)) {
+            std::fprintf(stderr, "unable to write %s.asm\n",
+                         function.c_str());
+            return 1;
+        }
+        list += "PROGRAM(" + function + ")\n";
+    }
+
+    if (!write_file(directory + "/random_programs.inc", list)) {
+        std::fprintf(stderr, "unable to write random_programs.inc\n");
+        return 1;
+    }
+}
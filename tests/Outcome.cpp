@@ -0,0 +1,25 @@
+#include "Outcome.h"
+
+#include <exception>
+#include <string>
+
+auto run(Machine &machine, const DispatchEngine &engine) -> Outcome {
+    Outcome outcome;
+    try {
+        outcome.ended = machine.run(engine);
+    } catch (const std::exception &e) {
+        outcome.error = e.what();
+    }
+    outcome.output = machine.output();
+    return outcome;
+}
+
+auto run(const Program &program, const DispatchEngine &engine) -> Outcome {
+    Machine machine(program);
+    return run(machine, engine);
+}
+
+auto describe(const Outcome &outcome) -> std::string {
+    return (outcome.ended ? "ended [" : "halted [") + outcome.output + "] " +
+           outcome.error;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Machine.h"
+#include "Program.h"
+
+#include <string>
+
+// What a run did, as far as anyone running a program can tell
+struct Outcome {
+    bool ended = false;
+    std::string output;
+    std::string error; // What the run threw, if anything
+
+    auto operator==(const Outcome &other) const -> bool {
+        return ended == other.ended && output == other.output &&
+               error == other.error;
+    }
+    auto operator!=(const Outcome &other) const -> bool {
+        return !(*this == other);
+    }
+};
+
+// Runs machine's program on the registers it holds
+auto run(Machine &machine, const DispatchEngine &engine) -> Outcome;
+
+// Runs program on a fresh Machine
+auto run(const Program &program, const DispatchEngine &engine) -> Outcome;
+
+// One line for a mismatch report
+auto describe(const Outcome &outcome) -> std::string;
@@ -0,0 +1,239 @@
+#include "ProgramGenerator.h"
+
+#include <algorithm>
+#include <climits>
+#include <iterator>
+
+namespace {
+
+constexpr const char *jumps[] = {"jne", "je", "jge", "jg", "jle", "jl"};
+
+// Near the limits, so that closed loops and folded arithmetic wrap around
+constexpr int bounds[] = {0,           1,          -1,      5,      -5,
+                          3,           INT_MAX - 2, INT_MIN + 2, INT_MAX,
+                          INT_MIN};
+
+} // namespace
+
+auto ProgramGenerator::program() -> std::string {
+    labels = 0;
+    return pick(3) == 2 ? loops() : structured();
+}
+
+auto ProgramGenerator::seed_value() -> int {
+    static const int values[] = {0,   1, -1, 2, 3, 7, -7,
+                                 100, 5, 9,  INT_MAX, INT_MIN};
+    return pick(4) != 0 ? values[pick(std::size(values))]
+                        : static_cast<int>(pick(41)) - 20;
+}
+
+auto ProgramGenerator::structured() -> std::string {
+    std::string source;
+    routines = static_cast<int>(pick(4));
+    recursive = 0;
+    for (int i = 0; i < routines; i++) {
+        recursive |= pick(3) == 0 ? 1U << i : 0;
+    }
+
+    if (pick(3) != 0) {
+        source += "mov a, " + std::to_string(pick(10)) + "\n";
+    }
+    if (pick(10) != 0) {
+        source += "mov b, 3\nmov c, -5\nmov d, 9\n";
+    }
+    if (pick(2) != 0) {
+        source += "mov e, 1\n";
+    }
+
+    routine = -1;
+    body(source, 0);
+    if (pick(10) != 0) {
+        source += "end\n";
+    }
+
+    // Subroutines only call the ones after them, and recursive ones
+    // themselves, as long as the register their caller set is above 0
+    for (routine = 0; routine < routines; routine++) {
+        const auto name = "f" + std::to_string(routine);
+        source += name + ":\n";
+        if ((recursive & 1U << routine) != 0) {
+            const auto done = label("R");
+            const auto depth = "r" + std::to_string(routine);
+            source += "cmp " + depth + ", 0\njle " + done + "\ndec " + depth +
+                      "\n";
+            body(source, 0);
+            source += "call " + name + "\n" + done + ":\n";
+        } else {
+            body(source, 0);
+        }
+        source += "ret\n";
+    }
+
+    return source;
+}
+
+auto ProgramGenerator::loops() -> std::string {
+    static const char *const counter_steps[] = {
+        "inc i", "dec i", "add i, 1", "sub i, 1", "add i, -1", "sub i, -1"};
+    static const char *const updates[] = {"inc", "dec", "add", "sub"};
+    std::string source;
+
+    for (const char *name : {"a", "b", "c", "d", "i", "n"}) {
+        if (pick(12) != 0) {
+            source += std::string("mov ") + name + ", " +
+                      std::to_string(bounds[pick(std::size(bounds))]) + "\n";
+        }
+    }
+
+    for (auto count = 1 + pick(2); count > 0; count--) {
+        const auto head = label("L");
+        source += head + ":\n";
+
+        const auto length = pick(4);
+        const auto step_at = pick(length + 1);
+        for (std::uint32_t k = 0; k <= length; k++) {
+            if (k == step_at) {
+                source += counter_steps[pick(std::size(counter_steps))];
+                source += "\n";
+                if (pick(8) == 0) {
+                    source += "add i, 2\nsub i, 2\n";
+                }
+            }
+            if (k < length) {
+                const auto update = pick(std::size(updates));
+                source += std::string(updates[update]) + " " + "abcd"[pick(4)];
+                if (update >= 2) {
+                    source += ", ";
+                    source += pick(2) != 0
+                                  ? std::to_string(
+                                        bounds[pick(std::size(bounds))])
+                                  : std::string(1, "abcdnii"[pick(7)]);
+                }
+                source += "\n";
+            }
+        }
+
+        source += "cmp i, " +
+                  (pick(2) != 0
+                       ? std::string("n")
+                       : std::to_string(bounds[pick(std::size(bounds))])) +
+                  "\n" + jumps[pick(std::size(jumps))] + " " + head + "\n";
+        if (pick(3) == 0) {
+            source += "jmp " + head + "\n";
+        }
+        source += "msg a, ' ', b, ' ', c, ' ', d, ' ', i\n";
+    }
+
+    source += "jle X\nmsg 'le'\nX:\nend\n";
+    return source;
+}
+
+auto ProgramGenerator::body(std::string &source, const int &depth) -> void {
+    for (auto count = 1 + pick(8); count > 0; count--) {
+        switch (pick(14)) {
+        case 0:
+        case 1:
+            source += "mov " + reg() + ", " + value() + "\n";
+            break;
+        case 2:
+            source += "inc " + reg() + "\n";
+            break;
+        case 3:
+            source += "dec " + reg() + "\n";
+            break;
+        case 4:
+            source += "add " + reg() + ", " + value() + "\n";
+            break;
+        case 5:
+            source += "sub " + reg() + ", " + value() + "\n";
+            break;
+        case 6:
+            source += "mul " + reg() + ", " + value() + "\n";
+            break;
+        case 7: {
+            // Divisors go through z, which never holds -1: INT_MIN / -1
+            // traps, as it does in C++
+            static const char *const divisors[] = {"7", "0", "2", "-3"};
+            const auto divisor = divisors[pick(std::size(divisors))];
+            if (pick(2) == 0) {
+                source += std::string("mov z, ") + divisor + "\n";
+            } else if (pick(2) == 0) {
+                source += "div " + reg() + ", " +
+                          (pick(2) == 0 ? std::string("z") : divisor) + "\n";
+            }
+            break;
+        }
+        case 8:
+            source += "msg '<', " + value() + ", '>', " + value() + "\n";
+            break;
+        case 9:
+            if (routine + 1 < routines) {
+                const auto callee =
+                    routine + 1 +
+                    static_cast<int>(pick(routines - routine - 1));
+                if ((recursive & 1U << callee) != 0) {
+                    source += "mov r" + std::to_string(callee) + ", " +
+                              std::to_string(pick(6)) + "\n";
+                }
+                source += "call f" + std::to_string(callee) + "\n";
+            }
+            break;
+        case 10:
+            if (depth < 2) { // A counted loop, up or down
+                const auto head = label("L");
+                const auto counter = "k" + head;
+                const auto trips = std::to_string(1 + pick(5));
+                const bool up = pick(2) != 0;
+
+                source += "mov " + counter + ", " + (up ? "0" : trips) +
+                          "\n" + head + ":\n";
+                body(source, depth + 1);
+                source += up ? "inc " + counter + "\ncmp " + counter + ", " +
+                                   trips + "\njl " + head + "\n"
+                             : "dec " + counter + "\ncmp " + counter +
+                                   ", 0\njg " + head + "\n";
+            }
+            break;
+        case 11: { // Skips a block on a comparison
+            const auto skip = label("S");
+            source += "cmp " + value() + ", " + value() + "\n" +
+                      jumps[pick(std::size(jumps))] + " " + skip + "\n";
+            body(source, std::min(depth + 1, 2));
+            source += skip + ":\n";
+            break;
+        }
+        case 12:
+            if (pick(20) == 0) {
+                source += "ret\n";
+            }
+            break;
+        default:
+            if (pick(30) == 0) {
+                source += "end\n";
+            }
+            break;
+        }
+    }
+}
+
+auto ProgramGenerator::reg() -> std::string {
+    return std::string(1, "abcde"[pick(5)]);
+}
+
+// A register, a constant, or rarely a number no int holds
+auto ProgramGenerator::value() -> std::string {
+    static const int constants[] = {0, 1, -1, 2, 7, INT_MAX, INT_MIN, 100000};
+    const auto kind = pick(200);
+
+    if (kind < 120) {
+        return reg();
+    }
+    if (kind == 199) {
+        return "99999999999";
+    }
+    return std::to_string(constants[pick(std::size(constants))]);
+}
+
+auto ProgramGenerator::label(const char *prefix) -> std::string {
+    return prefix + std::to_string(labels++);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <string>
+
+// Random programs for the differential tests: arithmetic, comparisons and
+// jumps, counted loops, subroutines, some recursive, 'msg', and now and
+// then one of the errors the engines report. The same seed always gives the
+// same programs.
+class ProgramGenerator {
+  public:
+    explicit ProgramGenerator(const std::uint32_t &seed) : rng(seed) {}
+
+    // A program of any shape. Most end, some run forever.
+    auto program() -> std::string;
+
+    // A number in [0, count)
+    auto pick(const std::uint32_t &count) -> std::uint32_t {
+        return rng() % count;
+    }
+
+    // A value to seed a register with, mostly small
+    auto seed_value() -> int;
+
+  private:
+    // Nested blocks of instructions, with subroutines after the main one
+    auto structured() -> std::string;
+    // Counted loops the optimizer can close, on bounds near the int limits
+    auto loops() -> std::string;
+
+    auto body(std::string &source, const int &depth) -> void;
+    auto reg() -> std::string;
+    auto value() -> std::string;
+    auto label(const char *prefix) -> std::string;
+
+    std::mt19937 rng;
+    int routines = 0; // Of the program being generated
+    std::uint32_t recursive = 0; // Bit i: routine i calls itself
+    int routine = -1; // Whose body is being generated, -1 for the main one
+    int labels = 0;
+};
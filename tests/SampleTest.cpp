@@ -0,0 +1,62 @@
+// Runs the sample programs on every engine, unoptimized and optimized, and
+// checks that each does exactly what the switch engine does on the
+// unoptimized program.
+// Usage: AsmInterpSampleTest <program.asm>...
+
+#include "Compiler.h"
+#include "Machine.h"
+#include "Outcome.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+
+auto main(int argc, char **argv) -> int {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <program.asm>...\n", argv[0]);
+        return 2;
+    }
+
+    static const std::pair<DispatchEngine, const char *> engines[] = {
+        {DispatchEngine::SWITCH, "switch"},
+        {DispatchEngine::THREADED, "threaded"},
+        {DispatchEngine::JIT, "jit"},
+    };
+
+    int mismatches = 0;
+    for (int i = 1; i < argc; i++) {
+        std::ifstream file(argv[i]);
+        std::stringstream source;
+        source << file.rdbuf();
+        if (!file) {
+            std::fprintf(stderr, "unable to read %s\n", argv[i]);
+            return 2;
+        }
+
+        const Program plain = compile(source.str());
+        const Program optimized =
+            compile(source.str(), OptimizerPasses::all());
+        const auto expected = run(plain, DispatchEngine::SWITCH);
+
+        for (const auto &[engine, name] : engines) {
+            for (const auto *program : {&plain, &optimized}) {
+                if (const auto outcome = run(*program, engine);
+                    outcome != expected) {
+                    std::fprintf(stderr,
+                                 "%s differs on %s%s\n  expected: %s\n"
+                                 "  actual:   %s\n",
+                                 name, argv[i],
+                                 program == &optimized ? ", optimized" : "",
+                                 describe(expected).c_str(),
+                                 describe(outcome).c_str());
+                    mismatches++;
+                }
+            }
+        }
+    }
+
+    std::printf("%d programs, %d mismatches\n", argc - 1, mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,78 @@
+// Translates an assembly program into C++, see Aot.h. Used at build time by
+// asminterp_add_program() in cmake/AsmInterpAot.cmake.
+// Usage: AsmInterpAot <source.asm> <function> <output.cpp> <output.h>
+
+#include "Aot.h"
+#include "Compiler.h"
+
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+static auto is_identifier(const std::string &name) -> bool {
+    if (name.empty() || std::isdigit(static_cast<unsigned char>(name[0]))) {
+        return false;
+    }
+    for (const char c : name) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_') {
+            return false;
+        }
+    }
+    return true;
+}
+
+static auto write_file(const std::string &path, const std::string &text)
+    -> bool {
+    std::ofstream file(path, std::ios::binary);
+    file << text;
+    return static_cast<bool>(file);
+}
+
+auto main(int argc, char **argv) -> int {
+    if (argc != 5) {
+        std::fprintf(stderr,
+                     "usage: %s <source.asm> <function> <output.cpp> "
+                     "<output.h>\n",
+                     argv[0]);
+        return 2;
+    }
+
+    const std::string source_path = argv[1];
+    const std::string function = argv[2];
+
+    if (!is_identifier(function)) {
+        std::fprintf(stderr, "%s is not a valid function name\n",
+                     function.c_str());
+        return 2;
+    }
+
+    std::ifstream file(source_path, std::ios::binary);
+    if (!file) {
+        std::fprintf(stderr, "unable to read %s\n", source_path.c_str());
+        return 1;
+    }
+    std::stringstream source;
+    source << file.rdbuf();
+
+    // Programs that don't compile are rejected here, at build time, rather
+    // than failing every time they run. Only their output is observable,
+    // so every optimization applies.
+    Program program;
+    try {
+        program = compile(source.str(), OptimizerPasses::all());
+    } catch (const std::exception &e) {
+        std::fprintf(stderr, "%s: %s\n", source_path.c_str(), e.what());
+        return 1;
+    }
+
+    if (!write_file(argv[3],
+                    translate_to_cpp(program, function, source_path)) ||
+        !write_file(argv[4], translate_to_cpp_header(function, source_path))) {
+        std::fprintf(stderr, "unable to write the translation of %s\n",
+                     source_path.c_str());
+        return 1;
+    }
+}